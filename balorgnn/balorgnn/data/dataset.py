@@ -10,6 +10,10 @@ class CustomData(Data):
             return self.num_bbs
         if key == "bb_batch":
             return 1
+        if key == "bb_loop_list" or key == "loop_parent":
+            return self.num_loops
+        if key == "loop_batch":
+            return 1
         if 'index' in key:
             return self.num_nodes
         else:
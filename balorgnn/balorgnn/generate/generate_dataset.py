@@ -104,6 +104,7 @@ class DatasetGenerator():
             graph_config_folder = "limerick"
 
         self.invocation = graph_config.invocation
+        self.add_loop_tree = graph_config.addLoopTree
         self.graph_encoders = graph_config.encoders
 
         self.kernels = defaultdict(list)
@@ -348,6 +349,10 @@ class DatasetGenerator():
                 cfg = graphToData.make_cfg_from_graph(graph)
                 cfg1 = cfg
 
+                loop_tree = None
+                if self.add_loop_tree:
+                    loop_tree = graphToData.make_loop_tree_from_graph(graph)
+
                 graph1 = graph
                 graph2 = None
 
@@ -401,6 +406,16 @@ class DatasetGenerator():
 
                     cfg = graphToData.CFG(cfg_edge_index, num_bbs, bb_batch)
 
+                    if self.add_loop_tree:
+                        loop_tree2 = graphToData.make_loop_tree_from_graph(graph)
+
+                        bb_loop_list = torch.cat((loop_tree.bb_loop_list, loop_tree2.bb_loop_list + loop_tree.num_loops), dim=0)
+                        loop_parent = torch.cat((loop_tree.loop_parent, loop_tree2.loop_parent + loop_tree.num_loops), dim=0)
+                        loop_attr = torch.cat((loop_tree.loop_attr, loop_tree2.loop_attr), dim=0)
+                        loop_batch = torch.cat((loop_tree.loop_batch, loop_tree2.loop_batch), dim=0)
+
+                        loop_tree = graphToData.LoopTree(loop_tree.num_loops + loop_tree2.num_loops, bb_loop_list, loop_parent, loop_attr, loop_batch)
+
 
                 ############################
 
@@ -463,6 +478,14 @@ class DatasetGenerator():
 
                 output_config_name = torch.tensor(self.output_config_name.value)
 
+                loop_data = {}
+                if loop_tree is not None:
+                    loop_data = dict(bb_loop_list = loop_tree.bb_loop_list,
+                                     loop_parent = loop_tree.loop_parent,
+                                     loop_attr = loop_tree.loop_attr,
+                                     num_loops = loop_tree.num_loops,
+                                     loop_batch = loop_tree.loop_batch)
+
 
                 data = CustomData(
                             x=node_array, 
@@ -481,6 +504,7 @@ class DatasetGenerator():
                             shift = shift,
                             join_shift = join_shift,
                             use_in_loss_mask = real_use_in_loss_mask,
+                            **loop_data,
                             # graph1 = str(graph1),
                             # graph2 = str(graph2)
                             )
@@ -560,6 +584,8 @@ if __name__ == "__main__":
     parser.add_argument("--merlin_only", action='store_true', help='Use only the post-merlin compiler graph representations for vast')
     parser.add_argument("--valid_only", action='store_true', help='Generate only valid designs for vast for regression estimation')
     parser.add_argument("--no_regen", action='store_true', help="Don't generate existing files")
+    parser.add_argument("--graph_cache", help="Folder the graph compiler keeps graphs in, so unchanged designs aren't compiled again")
+    parser.add_argument("--graph_cache_max_mb", type=int, help="Size limit of the graph cache folder")
 
 
 
@@ -619,4 +645,10 @@ if __name__ == "__main__":
     assert(len(kernelList) > 0)
 
     generator = DatasetGenerator(args.dataset_folder, args.graph_compiler, args.inputs_folder, args.output_folder, graph_config_name, kernelList, args.combine_vast, args.all_vast_21, args.merlin_only, args.valid_only, args.no_regen)
+
+    # the cache is keyed on everything the compiler is given, so it can be shared between configs and runs
+    if args.graph_cache is not None:
+        generator.invocation += f" --cache_dir {args.graph_cache}"
+        if args.graph_cache_max_mb is not None:
+            generator.invocation += f" --cache_max_mb {args.graph_cache_max_mb}"
     generator.generateData()
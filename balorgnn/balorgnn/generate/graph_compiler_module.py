@@ -0,0 +1,37 @@
+import os
+import sys
+
+import balorgnn.generate.graph_to_data as graphToData
+
+
+def import_graph_compiler(graph_compiler_dir):
+    # the extension is built next to the executable with `make python`
+    graph_compiler_dir = os.path.abspath(graph_compiler_dir)
+    if graph_compiler_dir not in sys.path:
+        sys.path.append(graph_compiler_dir)
+    import balor_graph_compiler
+    return balor_graph_compiler
+
+
+class GraphCompilerModule():
+    # runs the graph compiler inside this process, no process is spawned and no text is parsed
+    # the compiler keeps each parsed kernel until its source file changes
+    #
+    # ROSE isn't thread safe, so python threads take turns,
+    # use processes for parallelism
+    def __init__(self, graph_compiler_dir, flags=None):
+        self.module = import_graph_compiler(graph_compiler_dir)
+        self.flags = flags if flags is not None else []
+
+    def compile(self, encoders, src, top, dataset_index, graph_type, directives=None, flags=None):
+        # directives fill the auto{KEY} placeholders of the kernel's ACCEL pragmas
+        directives = {key: str(value) for key, value in (directives or {}).items()}
+        all_flags = self.flags + (flags or [])
+
+        buffer = self.module.compile(src, top, all_flags, directives, str(dataset_index), str(graph_type))
+        graph = graphToData.read_binary_graph(buffer)
+
+        x, edge_index, edge_attr = graphToData.make_graph_arrays_from_binary(encoders, graph)
+        bb_index = graphToData.make_bb_id_list_from_binary(graph)
+
+        return x, edge_index, edge_attr, bb_index
@@ -0,0 +1,43 @@
+import json
+import shlex
+import subprocess
+
+
+class GraphCompilerServer():
+    # keeps a graph compiler running with --serve, so each graph doesn't pay
+    # for process startup, ROSE initialization and parsing the kernel again
+    #
+    # the invocation is the usual one from the graph config,
+    # its switches apply to every request
+    def __init__(self, invocation):
+        command = shlex.split(invocation) + ["--serve"]
+        self.process = subprocess.Popen(command, stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+        self.next_id = 0
+
+    def get_graph(self, src, top, dataset_index, graph_type, directives=None, flags=None):
+        request = {"id": str(self.next_id), "src": src, "top": top, "datasetIndex": str(dataset_index), "graphType": str(graph_type)}
+        self.next_id += 1
+
+        # directives fill the auto{KEY} placeholders of the kernel's ACCEL pragmas
+        # so the same unmodified source file can be used for every design
+        if directives is not None:
+            request["directives"] = {key: str(value) for key, value in directives.items()}
+        if flags is not None:
+            request["flags"] = flags
+
+        self.process.stdin.write((json.dumps(request) + "\n").encode())
+        self.process.stdin.flush()
+
+        header_line = self.process.stdout.readline()
+        if not header_line:
+            raise RuntimeError("Graph compiler server exited")
+        header = json.loads(header_line)
+
+        if header["status"] != "ok":
+            raise RuntimeError(f"Graph compiler failed on {src}: {header['message']}")
+
+        return self.process.stdout.read(int(header["size"])).decode()
+
+    def close(self):
+        self.process.stdin.close()
+        self.process.wait()
@@ -306,6 +306,7 @@ class Config():
         self.encodeNodeType = True
 
         self.absorbTypes = False
+        self.internTypes = False
         self.absorbPragmas = False
         self.encodePreviousPipelined = False
         self.pipelinedUnroll = False
@@ -325,6 +326,14 @@ class Config():
 
         self.inline_on_graph = False
 
+        self.compactGraphs = False
+
+        # most nodes a graph can have, None for no budget
+        self.maxNodes = None
+
+        # the loop nest, for pooling BBs into loops, see make_loop_tree_from_graph
+        self.addLoopTree = False
+
 
         if graph_compiler_path is None:
             self.invocation = "./../../../graph_compiler/bin/graph_compiler --hide_values"
@@ -349,7 +358,7 @@ class Config():
 
 
         #need for cfg
-        self.invocation += " --add_bb_id"
+        self.invocation += " --add_bb_id --add_cfg"
         if self.encodeBBID:
             self.encoders.append(getBBEncoder())
 
@@ -393,6 +402,11 @@ class Config():
             for i in range(5):
                 self.encoders.append(getArrayWidthEncoder(i))
 
+        # one type node per type in each BB, instead of one per edge
+        if self.internTypes:
+            assert(not self.absorbTypes)
+            self.invocation += " --intern_types"
+
 
         if self.absorbPragmas:
             self.invocation += " --absorb_pragmas"
@@ -434,6 +448,18 @@ class Config():
         if self.reduceIteratorBitwidths:
             self.invocation += " --reduce_iterator_bitwidth"
 
+        # smaller graphs with the same meaning, the encoders don't change
+        if self.compactGraphs:
+            self.invocation += " --compact"
+
+        # graphs over the budget are made with more switches on than the encoders expect,
+        # the reductions graph attribute says which
+        if self.maxNodes is not None:
+            self.invocation += f" --max_nodes {self.maxNodes}"
+
+        if self.addLoopTree:
+            self.invocation += " --add_loop_tree"
+
         if self.encodeTripcount:
             self.encoders.append(getTripcountEncoder())
 
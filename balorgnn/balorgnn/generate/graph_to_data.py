@@ -1,3 +1,4 @@
+import json
 import numpy as np
 import torch
 
@@ -100,7 +101,195 @@ def make_graph_arrays(encoders, graph):
 
     return node_array, edge_array, edge_attr_array
 
+class BinaryGraph():
+    # a graph in the graph compiler's --format=bin output
+    # columns are numpy arrays that view the buffer without copying
+    def __init__(self, num_nodes, num_edges, node_columns, edge_index, edge_columns, cfg=None, graph_attr=None, loops=None):
+        self.num_nodes = num_nodes
+        self.num_edges = num_edges
+        self.node_columns = node_columns
+        self.edge_index = edge_index
+        self.edge_columns = edge_columns
+        self.cfg = cfg
+        self.loops = loops
+        # attributes of the whole graph, as strings, like graph_attr of a dot graph
+        self.graph_attr = graph_attr if graph_attr is not None else {}
+
+class BinaryCFG():
+    def __init__(self, num_bbs, edge_index, node_bbs):
+        self.num_bbs = num_bbs
+        self.edge_index = edge_index
+        self.node_bbs = node_bbs
+
+class BinaryLoops():
+    # the loop nest as the graph compiler writes it, loop indices are -1 outside every loop
+    def __init__(self, parents, tripcounts, unroll_factors, pipelined, node_loops, bb_loops):
+        self.parents = parents
+        self.tripcounts = tripcounts
+        self.unroll_factors = unroll_factors
+        self.pipelined = pipelined
+        self.node_loops = node_loops
+        self.bb_loops = bb_loops
+
+class BinaryColumn():
+    def __init__(self, values, categories=None):
+        self.values = values
+        self.categories = categories
+
+    def missing(self):
+        if self.categories is not None:
+            return self.values == -1
+        if self.values.dtype == np.float32:
+            return np.isnan(self.values)
+        return self.values == np.iinfo(np.int32).min
+
+    def check_present(self):
+        if self.missing().any():
+            raise ValueError("Some nodes or edges are missing this attribute")
+
+    def as_strings(self):
+        # the same strings the dot output would have had
+        self.check_present()
+        if self.categories is not None:
+            codes, inverse = np.unique(self.values, return_inverse=True)
+            return np.array([self.categories[code] for code in codes])[inverse]
+        if self.values.dtype == np.float32:
+            return np.array([f"{value:f}" for value in self.values])
+        return self.values.astype(str)
+
+    def as_floats(self):
+        if self.categories is not None:
+            return self.as_strings().astype(np.float64)
+        self.check_present()
+        return self.values.astype(np.float64)
+
+def read_binary_columns(buffer, data_offset, count, schema_columns):
+    # every graph has the same columns, string codes index the column's own list of strings
+    columns = {}
+    for column in schema_columns:
+        offset = data_offset + int(column["offset"])
+        if column["dtype"] == "string":
+            values = np.frombuffer(buffer, dtype="<i4", count=count, offset=offset)
+            # boost writes an empty list as ""
+            categories = list(column.get("categories") or [])
+            columns[column["name"]] = BinaryColumn(values, categories)
+        else:
+            dtype = "<i4" if column["dtype"] == "int32" else "<f4"
+            columns[column["name"]] = BinaryColumn(np.frombuffer(buffer, dtype=dtype, count=count, offset=offset))
+    return columns
+
+def read_binary_graph(buffer):
+    magic = bytes(buffer[:8])
+    if magic != b"BALORGR\0":
+        raise ValueError("Not a binary graph compiler output")
+
+    version, schema_size, num_nodes, num_edges = np.frombuffer(buffer, dtype="<u4", count=4, offset=8)
+    if version != 2:
+        raise ValueError(f"Unsupported binary graph version {version}")
+
+    header_size = 24
+    schema = json.loads(bytes(buffer[header_size:header_size + schema_size]).rstrip(b"\0"))
+    data_offset = header_size + int(schema_size)
+
+    num_nodes = int(num_nodes)
+    num_edges = int(num_edges)
+
+    node_columns = read_binary_columns(buffer, data_offset, num_nodes, schema["nodes"])
+    edge_columns = read_binary_columns(buffer, data_offset, num_edges, schema["edges"])
+
+    edge_index = np.frombuffer(buffer, dtype="<i8", count=2 * num_edges, offset=data_offset + int(schema["edgeIndex"]))
+    edge_index = edge_index.reshape(2, num_edges)
+
+    # only with --add_cfg
+    cfg = None
+    if "cfg" in schema:
+        num_bbs = int(schema["cfg"]["numBBs"])
+        num_bb_edges = int(schema["cfg"]["numEdges"])
+        bb_edges = np.frombuffer(buffer, dtype="<i8", count=2 * num_bb_edges, offset=data_offset + int(schema["cfg"]["edgeIndex"]))
+        node_bbs = np.frombuffer(buffer, dtype="<i8", count=num_nodes, offset=data_offset + int(schema["cfg"]["nodeBBs"]))
+        cfg = BinaryCFG(num_bbs, bb_edges.reshape(2, num_bb_edges), node_bbs)
+
+    # only with --add_loop_tree
+    loops = None
+    if "loops" in schema:
+        num_loops = int(schema["loops"]["numLoops"])
+        num_loop_bbs = int(schema["loops"]["numBBs"])
+        def loop_array(name, dtype, count):
+            return np.frombuffer(buffer, dtype=dtype, count=count, offset=data_offset + int(schema["loops"][name]))
+        loops = BinaryLoops(loop_array("parents", "<i8", num_loops),
+                            loop_array("tripcounts", "<f4", num_loops),
+                            loop_array("unrollFactors", "<f4", num_loops),
+                            loop_array("pipelined", "<i8", num_loops),
+                            loop_array("nodeLoops", "<i8", num_nodes),
+                            loop_array("bbLoops", "<i8", num_loop_bbs))
+
+    graph_attr = {name: str(value) for name, value in schema.get("graph", {}).items()}
+
+    return BinaryGraph(num_nodes, num_edges, node_columns, edge_index, edge_columns, cfg, graph_attr, loops)
+
+def get_attr_array_from_binary(encoders, columns, count, arrayType):
+    # the same features as get_attr_array, a column at a time
+    features = []
+    for encoder in encoders:
+        if encoder.type == arrayType:
+            # every column is in every graph, but graphs made without the attribute have none of its values
+            if encoder.label not in columns or (count and columns[encoder.label].missing().all()):
+                raise ValueError(f"Binary graph did not have attribute: {encoder.label}")
+            column = columns[encoder.label]
+            if encoder.method == EncoderMethod.ONE_HOT:
+                values = np.char.replace(column.as_strings(), " ", "")
+                try:
+                    one_hot = encoder.encoder.transform(values.reshape(-1, 1))
+                except Exception as e:
+                    modified_exception = ValueError(f"There was an error in one hot encoding {encoder.label}")
+                    raise modified_exception from e
+                features.append(one_hot)
+            if encoder.method == EncoderMethod.NORMALIZED:
+                normalized = [encoder.normalize(value) for value in column.as_floats()]
+                features.append(np.array(normalized).reshape(count, -1))
+
+    if features:
+        array = np.concatenate(features, axis=1).astype(np.float32)
+    else:
+        array = np.zeros((count, 0), dtype=np.float32)
+    array = torch.tensor(array)
+
+    # edges are bidirectional
+    # so need to concat the edge array with itself
+    if arrayType == EncoderType.EDGE:
+        num_edges, _ = array.shape
+        array = torch.concat([array, array])
+
+        # add a one hot encoding of edge direction
+        forward_edge_enc = torch.cat((torch.ones(num_edges, 1), torch.zeros(num_edges, 1)), dim=0)
+        backward_edge_enc = torch.cat((torch.zeros(num_edges, 1), torch.ones(num_edges, 1)), dim=0)
+
+        array = torch.cat((array, forward_edge_enc, backward_edge_enc), dim=1)
+
+    return array
+
+def make_graph_arrays_from_binary(encoders, graph):
+    node_array = get_attr_array_from_binary(encoders, graph.node_columns, graph.num_nodes, EncoderType.NODE)
+    edge_attr_array = get_attr_array_from_binary(encoders, graph.edge_columns, graph.num_edges, EncoderType.EDGE)
+
+    # bidirectional edges: concatenate each list with the other list
+    sources, destinations = graph.edge_index
+    coo = np.array([np.concatenate((sources, destinations)), np.concatenate((destinations, sources))], dtype=np.int64)
+    edge_array = torch.from_numpy(coo)
+
+    return node_array, edge_array, edge_attr_array
+
+def make_bb_id_list_from_binary(graph):
+    if graph.cfg is not None:
+        return torch.from_numpy(graph.cfg.node_bbs.astype(np.int64))
+    bb_list = graph.node_columns["bbID"].as_floats().astype(np.int64) - 1
+    return torch.tensor(bb_list, dtype=torch.int64)
+
 def make_bb_id_list(graph):
+    # the graph compiler adds the BB of each node itself with --add_cfg
+    if graph.graph_attr.get("nodeBBs"):
+        return torch.tensor(np.array(graph.graph_attr["nodeBBs"].split(), dtype=np.int64), dtype=torch.int64)
+
     bb_list = []
     for node in graph.nodes():
         bbID = int(node.attr["bbID"]) - 1
@@ -115,6 +304,53 @@ class CFG():
         self.num_bbs = num_bbs
         self.bb_batch = bb_batch
 
+class LoopTree():
+    # for pooling BBs into loops and loops into the graph
+    # loop 0 is everything outside a loop, so every BB has a loop, the compiler's loop i is loop i + 1
+    def __init__(self, num_loops, bb_loop_list, loop_parent, loop_attr, loop_batch):
+        self.num_loops = num_loops
+        # the innermost loop of each BB
+        self.bb_loop_list = bb_loop_list
+        # the loop each loop is in, loop 0 is in itself
+        self.loop_parent = loop_parent
+        # tripcount, unroll factor and pipelined of each loop
+        self.loop_attr = loop_attr
+        self.loop_batch = loop_batch
+
+def make_loop_tree_from_arrays(parents, tripcounts, unroll_factors, pipelined, bb_loops):
+    num_loops = len(parents) + 1
+
+    bb_loop_list = torch.from_numpy(np.asarray(bb_loops, dtype=np.int64) + 1)
+    loop_parent = torch.from_numpy(np.concatenate(([0], np.asarray(parents, dtype=np.int64) + 1)))
+
+    loop_attr = np.stack((np.asarray(tripcounts, dtype=np.float32),
+                          np.asarray(unroll_factors, dtype=np.float32),
+                          np.asarray(pipelined, dtype=np.float32)), axis=1).reshape(-1, 3)
+    loop_attr = np.concatenate((np.array([[1, 1, 0]], dtype=np.float32), loop_attr))
+
+    loop_batch = torch.zeros(num_loops, dtype=torch.int64)
+
+    return LoopTree(num_loops, bb_loop_list, loop_parent, torch.from_numpy(loop_attr), loop_batch)
+
+def make_loop_tree_from_binary(graph):
+    if graph.loops is None:
+        raise ValueError("Binary graph has no loop tree, run the graph compiler with --add_loop_tree")
+    loops = graph.loops
+    return make_loop_tree_from_arrays(loops.parents, loops.tripcounts, loops.unroll_factors, loops.pipelined, loops.bb_loops)
+
+def make_loop_tree_from_graph(graph):
+    if not graph.graph_attr.get("loopNumLoops"):
+        raise ValueError("Graph has no loop tree, run the graph compiler with --add_loop_tree")
+
+    def attr_array(name, dtype):
+        return np.array(graph.graph_attr[name].split(), dtype=dtype)
+
+    return make_loop_tree_from_arrays(attr_array("loopParents", np.int64),
+                                      attr_array("loopTripcounts", np.float32),
+                                      attr_array("loopUnrollFactors", np.float32),
+                                      attr_array("loopPipelined", np.float32),
+                                      attr_array("bbLoops", np.int64))
+
 def make_cfg(kernel_data, invocation, apply_directives, i=0):
     # the kernels are stored with pragma location labels
     # so apply directives is used to get a cpp file with no labels
@@ -138,7 +374,32 @@ def make_cfg(kernel_data, invocation, apply_directives, i=0):
 
     return make_cfg_from_graph(graph)
 
+def make_cfg_from_bb_edges(num_bbs, bb_edges):
+    # bb_edges is a (2, N) array with each edge between BBs once
+    sources, targets = bb_edges
+
+    # forward and backward edges, interleaved the same way make_cfg_from_graph does
+    source_list = np.stack((sources, targets), axis=1).reshape(-1)
+    target_list = np.stack((targets, sources), axis=1).reshape(-1)
+
+    cfg_edge_index = torch.from_numpy(np.array([source_list, target_list], dtype=np.int64))
+
+    bb_batch = torch.zeros(num_bbs, dtype=torch.int64)
+
+    return CFG(cfg_edge_index, num_bbs, bb_batch)
+
+def make_cfg_from_binary(graph):
+    if graph.cfg is None:
+        raise ValueError("Binary graph has no cfg, run the graph compiler with --add_cfg")
+    return make_cfg_from_bb_edges(graph.cfg.num_bbs, graph.cfg.edge_index)
+
 def make_cfg_from_graph(graph):
+    # the graph compiler adds the cfg itself with --add_cfg
+    if graph.graph_attr.get("cfgNumBBs"):
+        num_bbs = int(graph.graph_attr["cfgNumBBs"])
+        bb_edges = np.array(graph.graph_attr["cfgEdges"].split(), dtype=np.int64).reshape(-1, 2).T
+        return make_cfg_from_bb_edges(num_bbs, bb_edges)
+
     # this is not the most elegant solution, 
     # possibly there should be some kind of consolidated meta-data from the c++ graph compiler
     # but its not much effort to reverse engineer
@@ -89,6 +89,31 @@ class BasicBlockToGraphAggregate(BaseLayer):
         outs = []
         return out
     
+class BasicBlockToLoopAggregate(BaseLayer):
+    def __init__(self, size):
+        super(BasicBlockToLoopAggregate, self).__init__()
+        self.gate_nn = Sequential(Linear(size, size), ReLU(), Linear(size, 1))
+        self.glob = MyGlobalAttention(self.gate_nn, None)
+        self.clear_outs = True
+
+    def forward(self, data, input, outs):
+        # needs graphs made with --add_loop_tree, see make_loop_tree_from_graph
+        # a loop can have no BB of its own, e.g. when every BB of its body is shared with the code after it
+        num_loops = int(torch.as_tensor(data.num_loops).sum())
+        out, _ = self.glob(input, data.bb_loop_list, size=num_loops)
+        return out
+
+class LoopToGraphAggregate(BaseLayer):
+    def __init__(self, size):
+        super(LoopToGraphAggregate, self).__init__()
+        self.gate_nn = Sequential(Linear(size, size), ReLU(), Linear(size, 1))
+        self.glob = MyGlobalAttention(self.gate_nn, None)
+        self.clear_outs = True
+
+    def forward(self, data, input, outs):
+        out, _ = self.glob(input, data.loop_batch)
+        return out
+
 class JKN(BaseLayer):
     def __init__(self):
         super(JKN, self).__init__()
@@ -2,6 +2,22 @@ import argparse
 import subprocess
 import os
 
+# The switches of each mode, also used by scripts/bench.py
+# the compiler has the same sets as the configs of --configs, see CONFIGS in src/graph/args.h
+MODE_FLAGS = {
+    "base": [
+            "--proxy_programl",
+            ],
+    "opt": [
+            "--allocas_to_mem_elems",
+            "--remove_sexts",
+            "--remove_single_target_branches",
+            "--drop_func_call_proc",
+            "--absorb_types",
+            "--absorb_pragmas",
+            ],
+}
+
 def compile_graph(mode, src, top, make_pdf, generalize_types, outputFolder):
     # Base command
     command = ["./bin/graph_compiler", "--src", src, "--top", top, "--datasetIndex", "NA", "--graphType", "NA"]
@@ -14,21 +30,9 @@ def compile_graph(mode, src, top, make_pdf, generalize_types, outputFolder):
     if not generalize_types:
         command += ["--one_hot_types"]
 
-    if mode == "base":
-        command += [
-                    "--proxy_programl",
-                    ]
-    elif mode == "opt":
-        command += [
-                    "--allocas_to_mem_elems",
-                    "--remove_sexts",
-                    "--remove_single_target_branches",
-                    "--drop_func_call_proc",
-                    "--absorb_types",
-                    "--absorb_pragmas",
-                    ]
-    else:
+    if mode not in MODE_FLAGS:
         raise ValueError(f"Unknown mode: {mode}")
+    command += MODE_FLAGS[mode]
 
     os.makedirs(outputFolder, exist_ok=True)
 
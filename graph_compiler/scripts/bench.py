@@ -0,0 +1,197 @@
+import argparse
+import glob
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+# run from graph_compiler, like run_graph_compiler.py
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+from run_graph_compiler import MODE_FLAGS
+
+MACHSUITE_FOLDER = "../balorgnn/inputs/machsuite"
+DEFAULT_BASELINE = "bench/baseline.json"
+
+# phases in the table, the profile also has parseAst per function
+TABLE_PHASES = ["ROSE_INITIALIZE", "frontend", "getTopLevelFunctionDef", "parseAst", "printNodes", "runEdges",
+                "write:.dot"]
+
+TABLE_COLUMNS = ["kernel", "mode", "run", "graphs", "seconds", "graphsPerSec", "peakRssKB", "nodes", "edges"] + \
+                [f"phase:{phase}" for phase in TABLE_PHASES]
+
+
+# (kernel name, source file, top level function) of every bundled kernel
+def get_kernels():
+    kernels = []
+    for src in sorted(glob.glob(f"{MACHSUITE_FOLDER}/*.cpp")):
+        name = os.path.splitext(os.path.basename(src))[0]
+        kernels.append((name, src, name))
+    kernels.append(("2mm", "sample_inputs/2mm.cpp", "kernel_2mm"))
+    return kernels
+
+
+def run_compiler(command):
+    start = time.perf_counter()
+    result = subprocess.run(command, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    seconds = time.perf_counter() - start
+
+    if result.returncode != 0:
+        raise RuntimeError(f"{' '.join(command)} failed:\n{result.stderr}")
+    return seconds
+
+
+def read_profile(profile_file):
+    with open(profile_file) as file:
+        profile = json.load(file)
+
+    # property_tree writes every value as a string
+    phases = {name: float(phase["seconds"]) for name, phase in profile["phases"].items()}
+    counts = {name: int(count) for name, count in profile["counts"].items()}
+    return phases, counts, int(profile["peakRssKB"])
+
+
+# Run one kernel in one mode, the median of the repeats is kept
+# cold runs the compiler once per graph, warm generates every graph from one frontend parse with --batch
+def bench_kernel(compiler, kernel, mode, run, repeats, designs, work_folder):
+    name, src, top = kernel
+    profile_file = f"{work_folder}/profile.json"
+    command = [compiler, "--src", src, "--top", top, "--datasetIndex", "NA", "--graphType", "NA",
+               "--one_hot_types", "--profile", profile_file] + MODE_FLAGS[mode]
+
+    graphs = 1
+    if run == "warm":
+        graphs = designs
+        manifest_file = f"{work_folder}/manifest.jsonl"
+        with open(manifest_file, "w") as manifest:
+            for design in range(designs):
+                manifest.write(json.dumps({"name": f"design{design}", "directives": {}}) + "\n")
+        command += ["--batch", manifest_file, "--outputFolder", f"{work_folder}/"]
+
+    samples = []
+    for _ in range(repeats):
+        seconds = run_compiler(command)
+        samples.append((seconds, read_profile(profile_file)))
+    samples.sort(key=lambda sample: sample[0])
+    seconds, (phases, counts, peak_rss) = samples[len(samples) // 2]
+
+    # nodes made and edges written per graph
+    nodes = sum(count for count_name, count in counts.items() if count_name.startswith("nodes:")) // graphs
+    edges = sum(count for count_name, count in counts.items() if count_name.startswith("edges:")) // graphs
+
+    result = {
+        "kernel": name,
+        "mode": mode,
+        "run": run,
+        "graphs": graphs,
+        "seconds": seconds,
+        "graphsPerSec": graphs / seconds,
+        "peakRssKB": peak_rss,
+        "nodes": nodes,
+        "edges": edges,
+        "phases": phases,
+        "counts": counts,
+    }
+    return result
+
+
+def get_key(result):
+    return f"{result['kernel']}/{result['mode']}/{result['run']}"
+
+
+def print_table(results):
+    print(",".join(TABLE_COLUMNS))
+    for result in results:
+        row = []
+        for column in TABLE_COLUMNS:
+            if column.startswith("phase:"):
+                value = result["phases"].get(column[len("phase:"):], 0.0)
+            else:
+                value = result[column]
+            row.append(f"{value:.6f}" if isinstance(value, float) else str(value))
+        print(",".join(row))
+
+
+# returns the keys that got slower by more than the threshold
+def compare(results, baseline, threshold):
+    regressions = []
+
+    print("kernel,mode,run,graphsPerSec,baselineGraphsPerSec,change,peakRssKB,baselinePeakRssKB,nodes,baselineNodes")
+    for result in results:
+        key = get_key(result)
+        if key not in baseline:
+            continue
+        before = baseline[key]
+
+        change = result["graphsPerSec"] / before["graphsPerSec"] - 1
+        print(f"{result['kernel']},{result['mode']},{result['run']},{result['graphsPerSec']:.3f},"
+              f"{before['graphsPerSec']:.3f},{change:+.1%},{result['peakRssKB']},{before['peakRssKB']},"
+              f"{result['nodes']},{before['nodes']}")
+
+        if change < -threshold:
+            regressions.append(key)
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark the graph compiler over the bundled kernels")
+
+    parser.add_argument("--compiler", help="Path to the graph compiler", default="./bin/graph_compiler")
+    parser.add_argument("--kernels", nargs="*", help="Only run these kernels, e.g. gemm 2mm")
+    parser.add_argument("--modes", nargs="*", choices=list(MODE_FLAGS), default=list(MODE_FLAGS),
+                        help="Flag sets of run_graph_compiler.py to run")
+    parser.add_argument("--repeats", type=int, default=3, help="Runs of each kernel, the median is kept")
+    parser.add_argument("--designs", type=int, default=10, help="Graphs generated by each warm run")
+    parser.add_argument("--baseline", help="Results to compare against", default=DEFAULT_BASELINE)
+    parser.add_argument("--save_baseline", action="store_true", help="Store the results as the baseline")
+    parser.add_argument("--threshold", type=float, default=0.15,
+                        help="Fail when graphs/sec drops by more than this fraction of the baseline")
+    parser.add_argument("--output", help="Also write the full results, with every phase and count, as JSON")
+
+    args = parser.parse_args()
+
+    kernels = [kernel for kernel in get_kernels() if not args.kernels or kernel[0] in args.kernels]
+
+    results = []
+    with tempfile.TemporaryDirectory() as work_folder:
+        for kernel in kernels:
+            for mode in args.modes:
+                for run in ["cold", "warm"]:
+                    try:
+                        results.append(bench_kernel(args.compiler, kernel, mode, run, args.repeats, args.designs,
+                                                    work_folder))
+                    except RuntimeError as error:
+                        print(error, file=sys.stderr)
+
+    print_table(results)
+
+    results_by_key = {get_key(result): result for result in results}
+    if args.output:
+        with open(args.output, "w") as output:
+            json.dump(results_by_key, output, indent=4)
+
+    if args.save_baseline:
+        os.makedirs(os.path.dirname(args.baseline) or ".", exist_ok=True)
+        with open(args.baseline, "w") as baseline_file:
+            json.dump(results_by_key, baseline_file, indent=4)
+        print(f"Saved baseline to {args.baseline}")
+        return
+
+    if not os.path.exists(args.baseline):
+        print(f"No baseline at {args.baseline}, run with --save_baseline (make bench-baseline) to store one")
+        return
+
+    with open(args.baseline) as baseline_file:
+        baseline = json.load(baseline_file)
+
+    print()
+    regressions = compare(results, baseline, args.threshold)
+    if regressions:
+        print(f"Slower than the baseline by more than {args.threshold:.0%}: {', '.join(regressions)}")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,563 @@
+#include "batch.h"
+#include "cache.h"
+#include "commandLine.h"
+#include "designLimits.h"
+#include "statusManifest.h"
+#include "graph/graphGenerator.h"
+#include "graph/graphStats.h"
+#include "utility.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+namespace {
+
+// Write to a temporary file and rename it into place, so a graph under its own name is always complete
+void writeOutput(const std::string &fileName, const std::string &contents) {
+    std::string temporary = fileName + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        out << contents;
+        if (!out) {
+            throw std::runtime_error("Couldn't write " + fileName);
+        }
+    }
+    if (std::rename(temporary.c_str(), fileName.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Couldn't write " + fileName);
+    }
+}
+
+} // namespace
+
+namespace Balor {
+namespace Batch {
+
+std::vector<Design> readManifest(const std::string &manifestFile, const std::string &defaultDatasetIndex,
+                                 const std::string &defaultGraphType) {
+    std::ifstream manifest(manifestFile);
+    if (!manifest) {
+        throw std::invalid_argument("Couldn't open batch manifest: " + manifestFile);
+    }
+
+    std::vector<Design> designs;
+
+    std::string line;
+    int lineNum = 0;
+    while (std::getline(manifest, line)) {
+        lineNum++;
+
+        boost::algorithm::trim(line);
+        if (line.empty()) {
+            continue;
+        }
+
+        boost::property_tree::ptree tree;
+        try {
+            std::istringstream lineStream(line);
+            boost::property_tree::read_json(lineStream, tree);
+        } catch (boost::property_tree::json_parser_error e) {
+            throw std::invalid_argument("Couldn't parse line " + std::to_string(lineNum) + " of batch manifest: " +
+                                        e.message());
+        }
+
+        Design design;
+        design.name = tree.get<std::string>("name", "");
+        if (design.name.empty()) {
+            throw std::invalid_argument("Design on line " + std::to_string(lineNum) + " of batch manifest has no name");
+        }
+
+        design.datasetIndex = tree.get<std::string>("datasetIndex", defaultDatasetIndex);
+        design.graphType = tree.get<std::string>("graphType", defaultGraphType);
+
+        if (auto directives = tree.get_child_optional("directives")) {
+            for (auto &directive : *directives) {
+                design.directives[directive.first] = directive.second.get_value<std::string>();
+            }
+        }
+        if (auto vitisDirectives = tree.get_child_optional("vitisDirectives")) {
+            for (auto &directive : *vitisDirectives) {
+                design.vitisDirectives.push_back(directive.second.get_value<std::string>());
+            }
+        }
+
+        designs.push_back(design);
+    }
+
+    return designs;
+}
+
+std::vector<std::string> readVitisDirectives(const std::string &directivesFile) {
+    std::ifstream directives(directivesFile);
+    if (!directives) {
+        throw std::invalid_argument("Couldn't open Vitis directives: " + directivesFile);
+    }
+
+    std::vector<std::string> vitisDirectives;
+    std::string line;
+    while (std::getline(directives, line)) {
+        boost::algorithm::trim(line);
+        if (!line.empty()) {
+            vitisDirectives.push_back(line);
+        }
+    }
+    return vitisDirectives;
+}
+
+FailureManifest::FailureManifest(const std::string &outputFolder) : fileName(outputFolder + "failures.jsonl") {
+    std::remove(fileName.c_str());
+}
+
+void FailureManifest::add(const std::string &name, const std::string &reason, const std::string &message) {
+    if (!manifest.is_open()) {
+        manifest.open(fileName);
+    }
+
+    boost::property_tree::ptree failure;
+    failure.put("name", name);
+    failure.put("reason", reason);
+    failure.put("message", message);
+
+    boost::property_tree::write_json(manifest, failure, false);
+    // a run that is stopped still leaves the failures so far
+    manifest.flush();
+}
+
+DirectiveApplier::DirectiveApplier(SgProject *project) {
+    std::vector<SgNode *> pragmaDecs = querySubTree(project, V_SgPragmaDeclaration);
+
+    for (SgNode *pragmaNode : pragmaDecs) {
+        SgPragma *pragma = isSgPragmaDeclaration(pragmaNode)->get_pragma();
+
+        std::string pragmaTextUpper = boost::algorithm::to_upper_copy(pragma->get_name());
+        if (boost::algorithm::starts_with(pragmaTextUpper, "ACCEL")) {
+            originalPragmas.push_back(std::make_pair(pragma, pragma->get_name()));
+        }
+    }
+
+    for (SgNode *node : querySubTree(project, V_SgFunctionDefinition)) {
+        SgFunctionDefinition *functionDef = isSgFunctionDefinition(node);
+        functionDefs[functionDef->get_declaration()->get_name()] = functionDef;
+    }
+}
+
+void DirectiveApplier::apply(const Design &design) {
+    for (auto &originalPragma : originalPragmas) {
+        SgPragma *pragma = originalPragma.first;
+        std::string pragmaText = originalPragma.second;
+
+        bool matched = false;
+        for (auto &directive : design.directives) {
+            std::string placeholder = "auto{" + directive.first + "}";
+            if (pragmaText.find(placeholder) != std::string::npos) {
+                boost::algorithm::replace_all(pragmaText, placeholder, directive.second);
+                matched = true;
+            }
+        }
+
+        // an empty pragma is skipped by the pragma parser, same as the line being removed
+        if (!matched) {
+            pragmaText = "";
+        }
+
+        pragma->set_name(pragmaText);
+    }
+
+    applyVitisDirectives(design.vitisDirectives);
+}
+
+void DirectiveApplier::applyVitisDirectives(const std::vector<std::string> &vitisDirectives) {
+    // the pragmas of the previous design
+    removeInsertedPragmas();
+
+    for (const std::string &directive : vitisDirectives) {
+        insertVitisDirective(directive);
+    }
+}
+
+void DirectiveApplier::restore() {
+    for (auto &originalPragma : originalPragmas) {
+        originalPragma.first->set_name(originalPragma.second);
+    }
+    removeInsertedPragmas();
+}
+
+void DirectiveApplier::removeInsertedPragmas() {
+    for (SgPragmaDeclaration *pragmaDec : insertedPragmas) {
+        SageInterface::removeStatement(pragmaDec);
+    }
+    insertedPragmas.clear();
+}
+
+// e.g. set_directive_array_partition -type cyclic -factor 2 -dim 1 "gemm" m1
+void DirectiveApplier::insertVitisDirective(const std::string &directive) {
+    std::vector<std::string> words;
+    boost::algorithm::split(words, directive, boost::is_any_of(" \t"), boost::token_compress_on);
+    for (std::string &word : words) {
+        boost::algorithm::erase_all(word, "\"");
+    }
+
+    // the value after an option, e.g. 2 for -factor
+    auto getOption = [&](const std::string &option, const std::string &defaultValue) {
+        auto found = std::find(words.begin(), words.end(), option);
+        if (found == words.end() || found + 1 == words.end()) {
+            return defaultValue;
+        }
+        return *(found + 1);
+    };
+
+    const std::string &command = words.front();
+    const std::string &target = words.back();
+
+    if (command == "set_directive_unroll" || command == "set_directive_pipeline") {
+        // the loop is given as function/label, nested labels are the path to it
+        std::vector<std::string> path;
+        boost::algorithm::split(path, target, boost::is_any_of("/"));
+        if (path.size() < 2) {
+            throw std::invalid_argument("Vitis directive without a loop label: " + directive);
+        }
+        SgBasicBlock *body = getLabelledLoopBody(getFunctionDef(path.front(), directive), path.back(), directive);
+
+        if (command == "set_directive_pipeline") {
+            insertPragma("HLS PIPELINE", body);
+            return;
+        }
+
+        std::string factor = getOption("-factor", "1");
+        // apply_vitis_directives leaves out an unroll by 1
+        if (factor != "1") {
+            insertPragma("HLS UNROLL factor=" + factor, body);
+        }
+    } else if (command == "set_directive_array_partition" || command == "set_directive_resource") {
+        if (words.size() < 3) {
+            throw std::invalid_argument("Vitis directive without a function and variable: " + directive);
+        }
+        SgFunctionDefinition *functionDef = getFunctionDef(words[words.size() - 2], directive);
+
+        std::string pragmaText;
+        if (command == "set_directive_array_partition") {
+            pragmaText = "HLS ARRAY_PARTITION type=" + getOption("-type", "complete") + " variable=" + target +
+                         " factor=" + getOption("-factor", "1") + " dim=" + getOption("-dim", "1");
+        } else {
+            pragmaText = "HLS RESOURCE core=" + getOption("-core", "") + " variable=" + target;
+        }
+
+        for (SgInitializedName *parameter : functionDef->get_declaration()->get_args()) {
+            if (parameter->get_name().getString() == target) {
+                insertPragma(pragmaText, functionDef->get_body());
+                return;
+            }
+        }
+        for (SgNode *node : querySubTree(functionDef, V_SgVariableDeclaration)) {
+            SgVariableDeclaration *varDec = isSgVariableDeclaration(node);
+            for (SgInitializedName *variable : varDec->get_variables()) {
+                if (variable->get_name().getString() == target) {
+                    insertPragma(pragmaText, varDec->get_scope(), varDec);
+                    return;
+                }
+            }
+        }
+        throw std::invalid_argument("Couldn't find the variable of Vitis directive: " + directive);
+    } else if (command == "set_directive_inline") {
+        bool off = std::find(words.begin(), words.end(), "-off") != words.end();
+        insertPragma(off ? "HLS inline off" : "HLS inline on", getFunctionDef(target, directive)->get_body());
+    } else {
+        throw std::invalid_argument("Unsupported Vitis directive: " + directive);
+    }
+}
+
+SgFunctionDefinition *DirectiveApplier::getFunctionDef(const std::string &functionName,
+                                                       const std::string &directive) {
+    auto functionDef = functionDefs.find(functionName);
+    if (functionDef == functionDefs.end()) {
+        throw std::invalid_argument("Couldn't find the function of Vitis directive: " + directive);
+    }
+    return functionDef->second;
+}
+
+SgBasicBlock *DirectiveApplier::getLabelledLoopBody(SgFunctionDefinition *functionDef, const std::string &label,
+                                                    const std::string &directive) {
+    for (SgNode *node : querySubTree(functionDef, V_SgLabelStatement)) {
+        SgLabelStatement *labelStatement = isSgLabelStatement(node);
+        if (labelStatement->get_label().getString() != label) {
+            continue;
+        }
+
+        // the labelled statement is either kept in the label or is the next statement of the block
+        SgStatement *loop = labelStatement->get_statement();
+        if (!loop) {
+            loop = SageInterface::getNextStatement(labelStatement);
+        }
+
+        SgStatement *body = nullptr;
+        if (SgForStatement *forStatement = isSgForStatement(loop)) {
+            body = forStatement->get_loop_body();
+        } else if (SgWhileStmt *whileStmt = isSgWhileStmt(loop)) {
+            body = whileStmt->get_body();
+        }
+        if (!isSgBasicBlock(body)) {
+            throw std::invalid_argument("Label " + label + " isn't on a loop with a braced body: " + directive);
+        }
+        return isSgBasicBlock(body);
+    }
+    throw std::invalid_argument("Couldn't find the loop label of Vitis directive: " + directive);
+}
+
+// at the start of the scope, or after a statement in it
+void DirectiveApplier::insertPragma(const std::string &pragmaText, SgScopeStatement *scope, SgStatement *after) {
+    SgPragmaDeclaration *pragmaDec = SageBuilder::buildPragmaDeclaration(pragmaText, scope);
+    if (after) {
+        SageInterface::insertStatementAfter(after, pragmaDec);
+    } else {
+        SageInterface::prependStatement(pragmaDec, scope);
+    }
+    insertedPragmas.push_back(pragmaDec);
+}
+
+int runBatch(Sawyer::CommandLine::ParserResult parserResult, SgProject *project,
+             SgFunctionDefinition *topLevelFunctionDef) {
+    std::string manifestFile = Balor::CommandLine::getBatchManifest(parserResult);
+    std::string outputFolder = Balor::CommandLine::getOutputsFolder(parserResult);
+
+    std::string defaultDatasetIndex = parserResult.parsed("datasetIndex").back().asString();
+    std::string defaultGraphType = parserResult.parsed("graphType").back().asString();
+
+    std::vector<Design> designs = readManifest(manifestFile, defaultDatasetIndex, defaultGraphType);
+
+    // directives given with --vitis_directives apply to every design, before its own
+    std::string vitisDirectivesFile = Balor::CommandLine::getVitisDirectivesFile(parserResult);
+    if (!vitisDirectivesFile.empty()) {
+        std::vector<std::string> vitisDirectives = readVitisDirectives(vitisDirectivesFile);
+        for (Design &design : designs) {
+            design.vitisDirectives.insert(design.vitisDirectives.begin(), vitisDirectives.begin(),
+                                          vitisDirectives.end());
+        }
+    }
+
+    DirectiveApplier directiveApplier(project);
+    FailureManifest failureManifest(outputFolder);
+
+    double designTimeout = Balor::CommandLine::getDesignTimeout(parserResult);
+    long designMaxRssKB = Balor::CommandLine::getDesignMaxRssKB(parserResult);
+
+    // the source is the same for every design, so it's only described once
+    // only graphs are cached, not their stats
+    bool writeStats = parserResult.have("stats");
+    std::unique_ptr<Cache::GraphCache> graphCache = writeStats ? nullptr : Cache::makeGraphCache(parserResult);
+    std::string sourceDescription = Cache::describeSource(parserResult);
+    std::vector<std::string> formats = Balor::CommandLine::getOutputFormats(parserResult);
+
+    // a design is only skipped when resuming if it would be written the same way again
+    std::string outputDescription =
+        "outputs " + (writeStats ? std::string("stats") : boost::algorithm::join(formats, ",")) + "\n";
+    StatusManifest statusManifest(outputFolder + "batch_status.log", parserResult.have("resume"));
+    int resumed = 0;
+
+    // without --configs one graph, with the switches of the command line, under the design's name
+    std::vector<GraphConfig> configs = Balor::CommandLine::getGraphConfigs(parserResult);
+    bool namedConfigs = !configs.empty();
+    if (!namedConfigs) {
+        configs.push_back(GraphConfig());
+    }
+    std::vector<std::string> configNames;
+    for (const GraphConfig &config : configs) {
+        configNames.push_back(config.name);
+    }
+    outputDescription += "configs " + boost::algorithm::join(configNames, ",") + "\n";
+
+    // a design that failed may get through with other limits, a graph that was made is the same whatever they are
+    std::ostringstream limitsDescription;
+    limitsDescription << "designTimeout " << designTimeout << "\ndesignMaxRssKB " << designMaxRssKB << "\n";
+
+    // the structure of the graph doesn't depend on the directives when pragmas are absorbed,
+    // so the graph of the previous design is kept and only its pragma fields are set again
+    // each rebuilt graph reuses the memory of the one before, each config has its own arena
+    // as graphs sharing one have to be destroyed in the reverse order they were made
+    std::vector<std::unique_ptr<Balor::GraphArena>> arenas;
+    std::vector<std::unique_ptr<Balor::GraphGenerator>> graphGens(configs.size());
+    for (size_t config = 0; config < configs.size(); config++) {
+        arenas.push_back(std::make_unique<Balor::GraphArena>());
+    }
+
+    int failures = 0;
+    for (const Design &design : designs) {
+        std::chrono::steady_clock::time_point designBegin = std::chrono::steady_clock::now();
+
+        // the file names of each config's outputs start with
+        std::vector<std::string> fileStems;
+        std::vector<std::string> cacheInputs;
+        for (const GraphConfig &config : configs) {
+            fileStems.push_back(outputFolder + design.name + (namedConfigs ? "." + config.name : ""));
+            cacheInputs.push_back(
+                Cache::describeInputs(sourceDescription, parserResult, design, namedConfigs ? &config : nullptr));
+        }
+
+        StatusManifest::Entry status;
+        status.name = design.name;
+        std::string inputs = boost::algorithm::join(cacheInputs, "") + outputDescription;
+        status.inputHash = Cache::hashInputs(inputs);
+        status.status = "ok";
+
+        // failures are known by their limits too
+        std::string failedInputHash = Cache::hashInputs(inputs + limitsDescription.str());
+
+        // finished by an earlier run, failures included, so they aren't tried again every run
+        // unless the limits they failed with have changed
+        const StatusManifest::Entry *previous = statusManifest.find(design.name);
+        if (previous && previous->inputHash == (previous->status == "ok" ? status.inputHash : failedInputHash)) {
+            if (previous->status != "ok") {
+                failureManifest.add(design.name, previous->status, "Failed in an earlier run");
+                failures++;
+            }
+            resumed++;
+            continue;
+        }
+
+        if (graphCache) {
+            // the file name and graph of every config in every format
+            std::vector<std::pair<std::string, std::string>> cached;
+            for (size_t config = 0; config < configs.size(); config++) {
+                for (const std::string &format : formats) {
+                    std::string extension = makeGraphWriter(format)->getExtension();
+                    std::string graph;
+                    if (graphCache->lookup(cacheInputs[config], extension, graph)) {
+                        cached.push_back(std::make_pair(fileStems[config] + extension, graph));
+                    }
+                }
+            }
+
+            if (cached.size() == configs.size() * formats.size()) {
+                try {
+                    for (auto &graph : cached) {
+                        writeOutput(graph.first, graph.second);
+                        status.bytes += graph.second.size();
+                    }
+                } catch (std::runtime_error &e) {
+                    // generated as usual, which fails the design the same way
+                    cached.clear();
+                    status.bytes = 0;
+                }
+            }
+
+            if (cached.size() == configs.size() * formats.size()) {
+                status.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - designBegin).count();
+                statusManifest.add(status);
+                continue;
+            }
+        }
+
+        std::vector<std::string> fileNames;
+        std::streambuf *coutbuf = std::cout.rdbuf(); // save old buf
+
+        try {
+            // a design that goes over its limits is given up on at the next node or edge made
+            Limits::Guard guard(designTimeout, designMaxRssKB);
+
+            // a directive that doesn't fit the kernel only fails its design
+            // every config is generated from the same AST
+            directiveApplier.apply(design);
+
+            for (size_t config = 0; config < configs.size(); config++) {
+                std::unique_ptr<Balor::GraphGenerator> &graphGen = graphGens[config];
+                const GraphConfig *graphConfig = namedConfigs ? &configs[config] : nullptr;
+                std::string graphType = graphConfig ? graphConfig->graphType : design.graphType;
+
+                bool reannotated = false;
+                if (graphGen) {
+                    graphGen->datasetIndex = design.datasetIndex;
+                    graphGen->graphType = graphType;
+                    reannotated = graphGen->reannotatePragmas();
+                }
+
+                if (!reannotated) {
+                    // the old graph gives its arena memory back before the new one takes any
+                    graphGen.reset();
+                    graphGen = std::make_unique<Balor::GraphGenerator>(parserResult, arenas[config].get(), graphConfig);
+                    graphGen->datasetIndex = design.datasetIndex;
+                    graphGen->graphType = graphType;
+
+                    graphGen->generateGraph(topLevelFunctionDef);
+                }
+
+                if (writeStats) {
+                    std::ostringstream stats;
+                    writeGraphStats(*graphGen, stats);
+
+                    fileNames.push_back(fileStems[config] + ".stats.json");
+                    writeOutput(fileNames.back(), stats.str());
+                    status.bytes += stats.str().size();
+                    continue;
+                }
+
+                // one file for each output format, all from the same graph
+                for (auto &graphWriter : graphGen->graphWriters) {
+                    std::ostringstream graph;
+                    std::cout.rdbuf(graph.rdbuf()); // redirect std::cout
+
+                    graphGen->printGraph(*graphWriter);
+
+                    std::cout.rdbuf(coutbuf); // restore cout
+
+                    fileNames.push_back(fileStems[config] + graphWriter->getExtension());
+                    writeOutput(fileNames.back(), graph.str());
+                    status.bytes += graph.str().size();
+
+                    if (graphCache) {
+                        graphCache->store(cacheInputs[config], graphWriter->getExtension(), graph.str());
+                    }
+                }
+            }
+        } catch (std::exception &e) {
+            std::cout.rdbuf(coutbuf);
+
+            // don't leave a partial graph behind for the dataset generator to pick up
+            for (const std::string &fileName : fileNames) {
+                std::remove(fileName.c_str());
+            }
+
+            std::cerr << "Design " << design.name << " failed: " << e.what() << std::endl;
+            failures++;
+
+            // the graphs may be half built, start again for the next design
+            for (std::unique_ptr<Balor::GraphGenerator> &graphGen : graphGens) {
+                graphGen.reset();
+            }
+
+            Limits::LimitExceeded *limitExceeded = dynamic_cast<Limits::LimitExceeded *>(&e);
+            if (limitExceeded && limitExceeded->reason == "memory") {
+                // the arenas keep the memory of the largest graphs, which the next design doesn't need
+                for (std::unique_ptr<Balor::GraphArena> &arena : arenas) {
+                    arena->release();
+                }
+                Limits::releaseMemory();
+            }
+            status.status = limitExceeded ? limitExceeded->reason : "error";
+            status.inputHash = failedInputHash;
+            status.bytes = 0;
+            failureManifest.add(design.name, status.status, e.what());
+        }
+
+        // only once the design's files are in place, so an interrupted design is done again
+        status.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - designBegin).count();
+        statusManifest.add(status);
+    }
+
+    directiveApplier.restore();
+
+    if (resumed) {
+        std::cerr << "Resumed, " << resumed << " designs were finished by an earlier run" << std::endl;
+    }
+
+    return failures;
+}
+
+} // namespace Batch
+} // namespace Balor
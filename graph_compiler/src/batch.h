@@ -0,0 +1,92 @@
+#ifndef BALOR_BATCH_H
+#define BALOR_BATCH_H
+
+#include <Rose/CommandLine.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rose.h"
+
+namespace Balor {
+namespace Batch {
+
+// One design of a batch manifest
+// the directives are the values of the kernel's auto{KEY} placeholders
+// the Vitis directives are set_directive_* commands, e.g. set_directive_unroll -factor 2 "gemm/outer"
+struct Design {
+    std::string name;
+    std::string datasetIndex;
+    std::string graphType;
+    std::map<std::string, std::string> directives;
+    std::vector<std::string> vitisDirectives;
+};
+
+// Read a batch manifest, one JSON object per line
+// designs without a datasetIndex or graphType use the ones from the command line
+std::vector<Design> readManifest(const std::string &manifestFile, const std::string &defaultDatasetIndex,
+                                 const std::string &defaultGraphType);
+
+// Read Vitis directives, one set_directive_* command per line
+std::vector<std::string> readVitisDirectives(const std::string &directivesFile);
+
+// The designs that failed, written to <outputFolder>/failures.jsonl as they fail,
+// one {"name", "reason", "message"} per line, the reason is timeout, memory or error, or crash with --drive
+// the file is only made once a design fails, one left by an earlier run is removed
+class FailureManifest {
+  public:
+    FailureManifest(const std::string &outputFolder);
+
+    void add(const std::string &name, const std::string &reason, const std::string &message);
+
+  private:
+    std::string fileName;
+    std::ofstream manifest;
+};
+
+// Applies the directives of a design to the ACCEL pragmas of the parsed kernel,
+// the same way apply_merlin_directives in balorgnn rewrites the source file:
+// placeholders are replaced, and ACCEL pragmas without a matching directive are dropped
+//
+// Vitis directives are inserted as the HLS pragmas apply_vitis_directives would write, against loop labels
+// rather than lines: unroll and pipeline at the start of the labelled loop's body, array_partition and resource
+// after the variable's declaration, or at the start of the function for a parameter, and inline at the start
+// of the function
+//
+// The original pragma text is kept and inserted pragmas are removed again,
+// so each design starts from the unmodified kernel
+class DirectiveApplier {
+  public:
+    DirectiveApplier(SgProject *project);
+
+    void apply(const Design &design);
+    // only insert Vitis directives, ACCEL pragmas are left as they are
+    void applyVitisDirectives(const std::vector<std::string> &vitisDirectives);
+    void restore();
+
+  private:
+    void insertVitisDirective(const std::string &directive);
+    void removeInsertedPragmas();
+
+    SgFunctionDefinition *getFunctionDef(const std::string &functionName, const std::string &directive);
+    SgBasicBlock *getLabelledLoopBody(SgFunctionDefinition *functionDef, const std::string &label,
+                                      const std::string &directive);
+    void insertPragma(const std::string &pragmaText, SgScopeStatement *scope, SgStatement *after = nullptr);
+
+    std::vector<std::pair<SgPragma *, std::string>> originalPragmas;
+    std::map<std::string, SgFunctionDefinition *> functionDefs;
+    std::vector<SgPragmaDeclaration *> insertedPragmas;
+};
+
+// Generate a graph for every design in the manifest from one frontend parse
+// returns the number of designs that failed
+int runBatch(Sawyer::CommandLine::ParserResult parserResult, SgProject *project,
+             SgFunctionDefinition *topLevelFunctionDef);
+
+} // namespace Batch
+} // namespace Balor
+
+#endif
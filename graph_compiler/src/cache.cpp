@@ -0,0 +1,369 @@
+#include "cache.h"
+#include "commandLine.h"
+#include "graph/args.h"
+
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const std::string CACHE_VERSION = "balor graph cache 1";
+
+// a temporary file older than this was left by a process that died
+const long STALE_TEMPORARY_SECONDS = 3600;
+
+// the directory is listed at most this often, to see what other processes sharing it have stored
+const int EVICT_INTERVAL = 256;
+
+// eviction leaves a tenth of the limit free
+const long EVICT_SLACK = 10;
+
+// FNV-1a, two of them with different offsets make the 128 bit key
+// finished with the murmur3 mix so inputs that differ at the end differ in every bit
+uint64_t hashBytes(const std::string &bytes, uint64_t hash) {
+    for (unsigned char byte : bytes) {
+        hash ^= byte;
+        hash *= 0x100000001b3ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+std::string toHex(uint64_t value) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(value));
+    return hex;
+}
+
+std::string hashToHex(const std::string &bytes) {
+    return toHex(hashBytes(bytes, 0xcbf29ce484222325ULL)) + toHex(hashBytes(bytes, 0x84222325cbf29ce4ULL));
+}
+
+std::string shellQuote(const std::string &arg) {
+    std::string quoted = "'";
+    for (char c : arg) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+std::string readFile(const std::string &fileName) {
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file) {
+        throw std::invalid_argument("Couldn't find source file: " + fileName);
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// the source after the preprocessor, so edits to included headers count and comments don't
+// falls back to the file as it is when the preprocessor can't be run
+std::string preprocess(const std::vector<std::string> &frontendArgs, const std::string &srcFile) {
+    std::string command = "cpp -P";
+    for (size_t i = 0; i < frontendArgs.size(); i++) {
+        const std::string &arg = frontendArgs[i];
+        bool takesValue = arg == "-I" || arg == "-D" || arg == "-U";
+        if (takesValue && i + 1 < frontendArgs.size()) {
+            command += " " + shellQuote(arg) + " " + shellQuote(frontendArgs[i + 1]);
+            i++;
+        } else if (arg.compare(0, 2, "-I") == 0 || arg.compare(0, 2, "-D") == 0 || arg.compare(0, 2, "-U") == 0) {
+            command += " " + shellQuote(arg);
+        }
+    }
+    command += " " + shellQuote(srcFile) + " 2>/dev/null";
+
+    FILE *pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        return readFile(srcFile);
+    }
+
+    std::string preprocessed;
+    char chunk[4096];
+    size_t numRead;
+    while ((numRead = fread(chunk, 1, sizeof(chunk), pipe)) > 0) {
+        preprocessed.append(chunk, numRead);
+    }
+
+    if (pclose(pipe) != 0) {
+        return readFile(srcFile);
+    }
+    return preprocessed;
+}
+
+// the file this code was loaded from, the executable or the python module
+// by its size and modification time, not its path, so copies of one build and its different
+// install paths share entries
+std::string describeCompiler() {
+    Dl_info info;
+    struct stat fileStat;
+    if (!dladdr(reinterpret_cast<void *>(&describeCompiler), &info) || !info.dli_fname ||
+        stat(info.dli_fname, &fileStat) != 0) {
+        return "unknown";
+    }
+    return std::to_string(fileStat.st_size) + " " + std::to_string(fileStat.st_mtim.tv_sec) + "." +
+           std::to_string(fileStat.st_mtim.tv_nsec);
+}
+
+bool makeDirectory(const std::string &directory) { return mkdir(directory.c_str(), 0777) == 0 || errno == EEXIST; }
+
+struct CacheFile {
+    std::string path;
+    long size;
+    long modifiedTime;
+};
+
+// the entries are one directory deep, by the first two characters of their key
+std::vector<CacheFile> listCacheFiles(const std::string &directory) {
+    std::vector<CacheFile> files;
+
+    DIR *cacheDir = opendir(directory.c_str());
+    if (!cacheDir) {
+        return files;
+    }
+    while (dirent *subDirEntry = readdir(cacheDir)) {
+        // only the key folders, never ".." or anything else in the cache folder
+        std::string subDirName = subDirEntry->d_name;
+        if (subDirName.size() != 2 || !isxdigit(subDirName[0]) || !isxdigit(subDirName[1])) {
+            continue;
+        }
+
+        std::string subDirPath = directory + "/" + subDirName;
+        DIR *subDir = opendir(subDirPath.c_str());
+        if (!subDir) {
+            continue;
+        }
+        while (dirent *entry = readdir(subDir)) {
+            std::string path = subDirPath + "/" + entry->d_name;
+            struct stat fileStat;
+            if (entry->d_name[0] == '.' || stat(path.c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+                continue;
+            }
+            files.push_back(CacheFile{path, static_cast<long>(fileStat.st_size), fileStat.st_mtime});
+        }
+        closedir(subDir);
+    }
+    closedir(cacheDir);
+
+    return files;
+}
+
+} // namespace
+
+namespace Balor {
+namespace Cache {
+
+std::string describeSource(Sawyer::CommandLine::ParserResult parserResult) {
+    std::vector<std::string> frontendArgs = Balor::CommandLine::getFrontendArgs(parserResult);
+
+    // the source file is the last frontend arg
+    std::string srcFile = frontendArgs.back();
+    frontendArgs.pop_back();
+
+    std::string source = preprocess(frontendArgs, srcFile);
+
+    std::string description = CACHE_VERSION + "\n";
+    description += "compiler " + describeCompiler() + "\n";
+    description += "frontend " + boost::algorithm::join(frontendArgs, " ") + "\n";
+    description += "source " + hashToHex(source) + " " + std::to_string(source.size()) + "\n";
+    return description;
+}
+
+std::string hashInputs(const std::string &inputs) { return hashToHex(inputs); }
+
+std::string describeInputs(const std::string &sourceDescription, Sawyer::CommandLine::ParserResult parserResult,
+                           const Batch::Design &design, const GraphConfig *config) {
+    std::string description = sourceDescription;
+    description += "top " + Balor::CommandLine::getTopLevelFunctionName(parserResult) + "\n";
+    description += "datasetIndex " + design.datasetIndex + "\n";
+    description += "graphType " + (config ? config->graphType : design.graphType) + "\n";
+
+    // every switch, set or not, so a new switch doesn't match old entries
+    for (auto arg : Balor::ARGS) {
+        // only decide where the graph goes
+        if (arg.first == MAKE_DOT || arg.first == MAKE_PDF) {
+            continue;
+        }
+        bool set = parserResult.have(arg.first);
+        if (config) {
+            set |= std::find(config->args.begin(), config->args.end(), arg.first) != config->args.end();
+        }
+        description += "arg " + arg.first + " " + (set ? "1" : "0") + "\n";
+    }
+
+    description += "maxNodes " + std::to_string(Balor::CommandLine::getMaxNodes(parserResult)) + "\n";
+
+    for (auto &directive : design.directives) {
+        description += "directive " + directive.first + " " + directive.second + "\n";
+    }
+    for (const std::string &directive : design.vitisDirectives) {
+        description += "vitisDirective " + directive + "\n";
+    }
+    return description;
+}
+
+GraphCache::GraphCache(const std::string &directory, long maxBytes) : directory(directory), maxBytes(maxBytes) {
+    if (!makeDirectory(directory)) {
+        throw std::invalid_argument("Couldn't make cache folder: " + directory);
+    }
+}
+
+std::string GraphCache::getPath(const std::string &inputs, const std::string &extension) {
+    std::string key = hashToHex(inputs);
+    return directory + "/" + key.substr(0, 2) + "/" + key + extension;
+}
+
+bool GraphCache::lookup(const std::string &inputs, const std::string &extension, std::string &graph) {
+    std::string path = getPath(inputs, extension);
+
+    std::ifstream entry(path, std::ios::binary);
+    if (!entry) {
+        return false;
+    }
+
+    // the inputs are stored ahead of the graph, so a hash collision is a miss
+    size_t inputsSize = 0;
+    std::string line;
+    if (!std::getline(entry, line)) {
+        return false;
+    }
+    try {
+        inputsSize = std::stoul(line);
+    } catch (...) {
+        return false;
+    }
+
+    std::string storedInputs(inputsSize, '\0');
+    if (!entry.read(&storedInputs[0], inputsSize) || storedInputs != inputs) {
+        return false;
+    }
+
+    std::ostringstream contents;
+    contents << entry.rdbuf();
+    graph = contents.str();
+
+    // recently used, so it's removed last
+    utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+    return true;
+}
+
+void GraphCache::store(const std::string &inputs, const std::string &extension, const std::string &graph) {
+    std::string path = getPath(inputs, extension);
+
+    // the graph is still output when it can't be cached
+    if (!makeDirectory(path.substr(0, path.rfind('/')))) {
+        std::cerr << "Couldn't write cache entry: " << path << std::endl;
+        return;
+    }
+
+    // other processes only ever see the whole entry
+    std::string temporaryPath = path + ".tmp" + std::to_string(getpid());
+    bool written;
+    {
+        std::ofstream entry(temporaryPath, std::ios::binary);
+        entry << inputs.size() << "\n" << inputs << graph;
+        written = static_cast<bool>(entry);
+    }
+    if (!written || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        std::cerr << "Couldn't write cache entry: " << path << std::endl;
+        return;
+    }
+
+    if (maxBytes <= 0) {
+        return;
+    }
+
+    // listing the directory is the slow part, so it's only done when this process may have
+    // filled the cache, or every so many entries for what the others have added
+    storesSinceEvict++;
+    if (knownBytes >= 0) {
+        knownBytes += inputs.size() + graph.size();
+    }
+    if (knownBytes < 0 || knownBytes > maxBytes || storesSinceEvict >= EVICT_INTERVAL) {
+        evict();
+    }
+}
+
+void GraphCache::evict() {
+    // one process evicts at a time, the others carry on without waiting
+    std::string lockPath = directory + "/.lock";
+    int lock = open(lockPath.c_str(), O_CREAT | O_RDWR, 0666);
+    if (lock < 0) {
+        return;
+    }
+    if (flock(lock, LOCK_EX | LOCK_NB) != 0) {
+        close(lock);
+        return;
+    }
+    storesSinceEvict = 0;
+
+    std::vector<CacheFile> files = listCacheFiles(directory);
+    long now = time(nullptr);
+
+    long totalBytes = 0;
+    std::vector<CacheFile> entries;
+    for (const CacheFile &file : files) {
+        if (file.path.find(".tmp") != std::string::npos) {
+            if (now - file.modifiedTime > STALE_TEMPORARY_SECONDS) {
+                std::remove(file.path.c_str());
+            }
+            continue;
+        }
+        totalBytes += file.size;
+        entries.push_back(file);
+    }
+
+    // least recently used first, a process still reading a removed entry keeps its open file
+    std::sort(entries.begin(), entries.end(),
+              [](const CacheFile &a, const CacheFile &b) { return a.modifiedTime < b.modifiedTime; });
+    // down to a little under the limit, so the next few stores don't have to evict again
+    long targetBytes = totalBytes > maxBytes ? maxBytes - maxBytes / EVICT_SLACK : maxBytes;
+    for (const CacheFile &entry : entries) {
+        if (totalBytes <= targetBytes) {
+            break;
+        }
+        if (std::remove(entry.path.c_str()) == 0) {
+            totalBytes -= entry.size;
+        }
+    }
+    knownBytes = totalBytes;
+
+    flock(lock, LOCK_UN);
+    close(lock);
+}
+
+std::unique_ptr<GraphCache> makeGraphCache(Sawyer::CommandLine::ParserResult parserResult) {
+    std::string directory = Balor::CommandLine::getCacheDir(parserResult);
+    if (directory.empty()) {
+        return nullptr;
+    }
+    return std::make_unique<GraphCache>(directory, Balor::CommandLine::getCacheMaxBytes(parserResult));
+}
+
+} // namespace Cache
+} // namespace Balor
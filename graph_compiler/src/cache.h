@@ -0,0 +1,65 @@
+#ifndef BALOR_CACHE_H
+#define BALOR_CACHE_H
+
+#include <Rose/CommandLine.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "batch.h"
+#include "graph/args.h"
+#include "rose.h"
+
+namespace Balor {
+namespace Cache {
+
+// Describe the source a graph is made from: the preprocessed source text, the other frontend args
+// and the graph compiler binary itself, so graphs from an older build are never used
+// the path of the source file doesn't matter, only its contents
+std::string describeSource(Sawyer::CommandLine::ParserResult parserResult);
+
+// Describe everything a graph depends on: the source, --top, every graph switch,
+// the dataset index, graph type and directives of the design
+// with a config, its switches are on and the graph type is its own
+std::string describeInputs(const std::string &sourceDescription, Sawyer::CommandLine::ParserResult parserResult,
+                           const Batch::Design &design, const GraphConfig *config = nullptr);
+
+// A 128 bit hash of the inputs in hex, what they are known by on disk
+std::string hashInputs(const std::string &inputs);
+
+// Graphs stored on disk by a hash of their inputs, one file per graph and output format
+//
+// entries are written to a temporary file and renamed into place, so worker processes sharing
+// the directory never see a partial graph. A hit updates the entry's modification time,
+// and the least recently used entries are removed when the directory grows past its limit,
+// checked when this process has stored enough to pass it, or every few hundred entries
+class GraphCache {
+  public:
+    // no limit when maxBytes is 0
+    GraphCache(const std::string &directory, long maxBytes);
+
+    // true and the graph if there's an entry for the inputs in this format
+    bool lookup(const std::string &inputs, const std::string &extension, std::string &graph);
+    void store(const std::string &inputs, const std::string &extension, const std::string &graph);
+
+  private:
+    std::string directory;
+    long maxBytes;
+
+    // the size of the directory when this process last evicted, plus what it has stored since
+    // -1 before the first eviction
+    long knownBytes = -1;
+    int storesSinceEvict = 0;
+
+    std::string getPath(const std::string &inputs, const std::string &extension);
+    void evict();
+};
+
+// The cache for --cache_dir, nullptr without it
+std::unique_ptr<GraphCache> makeGraphCache(Sawyer::CommandLine::ParserResult parserResult);
+
+} // namespace Cache
+} // namespace Balor
+
+#endif
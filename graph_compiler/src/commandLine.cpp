@@ -1,5 +1,10 @@
 #include "commandLine.h"
 #include "graph/args.h"
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <thread>
+
 namespace {
 
 void addHelpArg(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
@@ -103,6 +108,294 @@ void addGraphTypeArg(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
     inputArgGroup.insert(graphType);
 }
 
+void addFormatArg(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
+    using namespace Sawyer::CommandLine;
+
+    // create format arg
+    Switch format = Switch("format");
+
+    // specify that the format arg takes a string as argument
+    // argument name is "format" in the man page
+    format.argument("format", anyParser());
+
+    // specify arg description in man page
+    format.doc("Specify the output format, dot (default) or bin, or several separated by commas, "
+               "e.g. dot,bin, to write each from the same graph when writing files. "
+               "bin is a little-endian columnar format with a JSON schema, "
+               "see graph/graphWriter.h and read_binary_graph in balorgnn/generate/graph_to_data.py");
+
+    // register arg
+    inputArgGroup.insert(format);
+}
+
+void addCacheArgs(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
+    using namespace Sawyer::CommandLine;
+
+    // create cache dir arg
+    Switch cacheDir = Switch("cache_dir");
+
+    // specify that the cache dir arg takes a string as argument
+    // argument name is "folder" in the man page
+    cacheDir.argument("folder", anyParser());
+
+    // specify arg description in man page
+    cacheDir.doc("Keep generated graphs in this folder, keyed by a hash of the preprocessed source, --top, "
+                 "the graph switches, datasetIndex, graphType and directives. A graph that is already there "
+                 "is output without parsing the source. The folder can be shared by several processes.");
+
+    // register arg
+    inputArgGroup.insert(cacheDir);
+
+    // create cache size arg
+    Switch cacheMaxMB = Switch("cache_max_mb");
+
+    // specify that the cache size arg takes a string as argument
+    // argument name is "megabytes" in the man page
+    cacheMaxMB.argument("megabytes", anyParser());
+
+    // specify arg description in man page
+    cacheMaxMB.doc("With --cache_dir, remove the least recently used graphs when the folder is larger than this.");
+
+    // register arg
+    inputArgGroup.insert(cacheMaxMB);
+}
+
+void addBatchArg(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
+    using namespace Sawyer::CommandLine;
+
+    // create batch arg
+    Switch batch = Switch("batch");
+
+    // specify that the batch arg takes a string as argument
+    // argument name is "manifestFile" in the man page
+    batch.argument("manifestFile", anyParser());
+
+    // specify arg description in man page
+    batch.doc("Parse the source file once and generate one graph per design in the manifest. "
+              "Each line of the manifest is a JSON object with a \"name\" and a \"directives\" object, "
+              "whose values replace the auto{KEY} placeholders of the kernel's ACCEL pragmas. "
+              "\"vitisDirectives\" is a list of Vitis set_directive_* commands inserted against the kernel's loop labels. "
+              "\"datasetIndex\" and \"graphType\" can be given per design to override the command line. "
+              "Graphs are written to <outputFolder>/<name>.dot. What happened to each design is appended "
+              "to <outputFolder>/batch_status.log as it finishes.");
+
+    // register arg
+    inputArgGroup.insert(batch);
+
+    // create resume arg
+    Switch resume = Switch("resume");
+
+    // specify arg description in man page
+    resume.doc("With --batch, skip the designs <outputFolder>/batch_status.log has from an earlier run with the "
+               "same inputs, whether they were generated or failed, instead of starting the log again. Failed designs are "
+               "tried again if --design_timeout or --design_max_rss has changed.");
+
+    // register arg
+    inputArgGroup.insert(resume);
+}
+
+void addServeArgs(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
+    using namespace Sawyer::CommandLine;
+
+    // create serve arg
+    Switch serve = Switch("serve");
+
+    // specify arg description in man page
+    serve.doc("Keep running and generate a graph for each request read from stdin, or from --socket. "
+              "Each request is a line with a JSON object with \"src\" and \"top\", and optionally \"id\", "
+              "\"flags\" (a list of switches, e.g. [\"inline_functions\"]), \"datasetIndex\", \"graphType\" "
+              "\"directives\" (the values of the kernel's auto{KEY} placeholders) and \"vitisDirectives\". "
+              "Each response is a line with a JSON object with \"status\", \"id\", and \"size\" or \"message\", "
+              "followed by \"size\" bytes of graph, in the --format of the request or the server. Switches given with "
+              "--serve, including --format, --cache_dir and the design limits, apply to every request. Parsed source "
+              "files are kept until they change.");
+
+    // register arg
+    inputArgGroup.insert(serve);
+
+    // create socket arg
+    Switch socket = Switch("socket");
+
+    // specify that the socket arg takes a string as argument
+    // argument name is "socketPath" in the man page
+    socket.argument("socketPath", anyParser());
+
+    // specify arg description in man page
+    socket.doc("With --serve, listen for requests on a unix domain socket at this path instead of stdin.");
+
+    // register arg
+    inputArgGroup.insert(socket);
+}
+
+void addDriveArgs(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
+    using namespace Sawyer::CommandLine;
+
+    // create drive arg
+    Switch drive = Switch("drive");
+
+    // specify that the drive arg takes a string as argument
+    // argument name is "jobsFile" in the man page
+    drive.argument("jobsFile", anyParser());
+
+    // specify arg description in man page
+    drive.doc("Generate a graph for every line of the jobs file, each a --serve request with a \"name\", "
+              "with --workers processes. A worker keeps to one kernel, the \"src\" and \"top\" of a job, "
+              "while it has jobs left, then starts the largest kernel no worker has yet, or helps the kernel "
+              "with the most jobs left, taking them from the end of its queue. Each graph is written to <outputFolder>/<name>.dot, or .bin with --format=bin, "
+              "as soon as it is done. The nodes of each kernel are kept in <outputFolder>/.drive_sizes.json, so the next run "
+              "starts the largest kernels first.");
+
+    // register arg
+    inputArgGroup.insert(drive);
+
+    // create workers arg
+    Switch workers = Switch("workers");
+
+    // specify that the workers arg takes a string as argument
+    // argument name is "count" in the man page
+    workers.argument("count", anyParser());
+
+    // specify arg description in man page
+    workers.doc("With --drive, the number of worker processes, defaults to the number of cores.");
+
+    // register arg
+    inputArgGroup.insert(workers);
+}
+
+void addDesignLimitArgs(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
+    using namespace Sawyer::CommandLine;
+
+    // create design timeout arg
+    Switch designTimeout = Switch("design_timeout");
+
+    // specify that the design timeout arg takes a string as argument
+    // argument name is "seconds" in the man page
+    designTimeout.argument("seconds", anyParser());
+
+    // specify arg description in man page
+    designTimeout.doc("With --batch, --serve or --drive, give up on a design that takes longer than this to generate, "
+                      "and go on to the next one in the same process. Failed designs are written to "
+                      "<outputFolder>/failures.jsonl with the reason, timeout, memory or error. With --drive, a "
+                      "worker that hasn't answered 30 seconds after the timeout, or 5 minutes more on a kernel's "
+                      "first job, is killed and started again.");
+
+    // register arg
+    inputArgGroup.insert(designTimeout);
+
+    // create design max rss arg
+    Switch designMaxRss = Switch("design_max_rss");
+
+    // specify that the design max rss arg takes a string as argument
+    // argument name is "megabytes" in the man page
+    designMaxRss.argument("megabytes", anyParser());
+
+    // specify arg description in man page
+    designMaxRss.doc("With --batch, --serve or --drive, give up on a design once the process's resident set grows "
+                     "past this many megabytes while generating it, parsed source files included.");
+
+    // register arg
+    inputArgGroup.insert(designMaxRss);
+}
+
+void addConfigsArg(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
+    using namespace Sawyer::CommandLine;
+
+    // create configs arg
+    Switch configs = Switch("configs");
+
+    // specify that the configs arg takes a string as argument
+    // argument name is "configList" in the man page
+    configs.argument("configList", anyParser());
+
+    // specify arg description in man page
+    configs.doc("Parse the source once and generate a graph for each comma separated config, with the config's "
+                "switches on top of the command line's. A config is base or opt, the modes of "
+                "run_graph_compiler.py, or name=switch+switch, e.g. --configs base,opt,small=hide_values+compact. "
+                "The graph type of each is its place in the list, from 0. Graphs are written to "
+                "<outputFolder>/<top>.<config>.dot with --make_dot, or <outputFolder>/<name>.<config>.dot with --batch.");
+
+    // register arg
+    inputArgGroup.insert(configs);
+}
+
+void addMaxNodesArg(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
+    using namespace Sawyer::CommandLine;
+
+    // create max nodes arg
+    Switch maxNodes = Switch("max_nodes");
+
+    // specify that the max nodes arg takes a string as argument
+    // argument name is "count" in the man page
+    maxNodes.argument("count", anyParser());
+
+    // specify arg description in man page
+    maxNodes.doc("Keep the graph to at most this many nodes. While it has more, the next of remove_sexts, "
+                 "remove_single_target_branches, only_memory_control_flow, hide_values, absorb_types and "
+                 "absorb_pragmas is turned on and the graph is made again. The budget and the switches turned "
+                 "on are written as the graph attributes maxNodes and reductions. A graph can still have more "
+                 "nodes once every one is on.");
+
+    // register arg
+    inputArgGroup.insert(maxNodes);
+}
+
+void addVitisDirectivesArg(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
+    using namespace Sawyer::CommandLine;
+
+    // create vitis directives arg
+    Switch vitisDirectives = Switch("vitis_directives");
+
+    // specify that the vitis directives arg takes a string as argument
+    // argument name is "file" in the man page
+    vitisDirectives.argument("file", anyParser());
+
+    // specify arg description in man page
+    vitisDirectives.doc("Insert the HLS pragmas of the Vitis directives in this file, one set_directive_* command "
+                        "per line, into the kernel before generating the graph. unroll and pipeline are found by "
+                        "their loop label, e.g. set_directive_unroll -factor 2 \"gemm/outer\", so the labelled "
+                        "source can be given as is.");
+
+    // register arg
+    inputArgGroup.insert(vitisDirectives);
+}
+
+void addStatsArg(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
+    using namespace Sawyer::CommandLine;
+
+    // create stats arg
+    Switch stats = Switch("stats");
+
+    // specify arg description in man page
+    stats.doc("Instead of the graph, output counts that describe it as JSON: the nodes of each NodeVariant, "
+              "the edges of each flow type, the nodes and edges of each function and BB, the deepest loop "
+              "nesting and the largest unroll factor. With --batch they are written to "
+              "<outputFolder>/<name>.stats.json. See graph/graphStats.h");
+
+    // register arg
+    inputArgGroup.insert(stats);
+}
+
+void addProfileArg(Sawyer::CommandLine::SwitchGroup &inputArgGroup) {
+    using namespace Sawyer::CommandLine;
+
+    // create profile arg
+    Switch profile = Switch("profile");
+
+    // specify that the profile arg takes a string as argument
+    // argument name is "file" in the man page
+    profile.argument("file", anyParser());
+
+    // specify arg description in man page
+    profile.doc("Write the wall time and memory growth of each phase, ROSE_INITIALIZE, frontend, getTopLevelFunctionDef, "
+                "parseAst per function, printing nodes and running edges, and writing, to this file as JSON, "
+                "with the nodes made of each NodeVariant, the edges of each flow type and the number of "
+                "unparse and querySubTree calls. Phases add up over the designs of --batch and requests of --serve. "
+                "Each --drive worker writes its own to <file>.worker<pid> when it exits.");
+
+    // register arg
+    inputArgGroup.insert(profile);
+}
+
 Sawyer::CommandLine::SwitchGroup specifyInputArgs() {
     using namespace Sawyer::CommandLine;
 
@@ -118,6 +411,18 @@ Sawyer::CommandLine::SwitchGroup specifyInputArgs() {
     addDatasetIndexArg(inputArgGroup);
     addGraphTypeArg(inputArgGroup);
 
+    addFormatArg(inputArgGroup);
+    addBatchArg(inputArgGroup);
+    addServeArgs(inputArgGroup);
+    addDriveArgs(inputArgGroup);
+    addCacheArgs(inputArgGroup);
+    addMaxNodesArg(inputArgGroup);
+    addConfigsArg(inputArgGroup);
+    addDesignLimitArgs(inputArgGroup);
+    addProfileArg(inputArgGroup);
+    addStatsArg(inputArgGroup);
+    addVitisDirectivesArg(inputArgGroup);
+
     // add the other args
     for (auto argTuple : Balor::ARGS) {
         std::string argName = argTuple.first;
@@ -229,5 +534,211 @@ std::string getOutputsFolder(Sawyer::CommandLine::ParserResult parserResult) {
     return folder;
 }
 
+std::vector<std::string> getOutputFormats(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("format")) {
+        return {"dot"};
+    }
+
+    std::vector<std::string> formats;
+    boost::algorithm::split(formats, parserResult.parsed("format").back().asString(), boost::is_any_of(","));
+
+    for (const std::string &format : formats) {
+        if (format != "dot" && format != "bin") {
+            throw std::invalid_argument("Unknown output format: " + format +
+                                        ", please use --format=dot, --format=bin or --format=dot,bin.");
+        }
+    }
+    return formats;
+}
+
+std::string getBatchManifest(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("batch")) {
+        return "";
+    }
+    return parserResult.parsed("batch").back().asString();
+}
+
+std::string getServeSocket(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("socket")) {
+        return "";
+    }
+    return parserResult.parsed("socket").back().asString();
+}
+
+std::string getDriveJobs(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("drive")) {
+        return "";
+    }
+    return parserResult.parsed("drive").back().asString();
+}
+
+int getNumWorkers(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("workers")) {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::string count = parserResult.parsed("workers").back().asString();
+    try {
+        size_t end;
+        int parsed = std::stoi(count, &end);
+        if (end == count.size() && parsed > 0) {
+            return parsed;
+        }
+    } catch (std::exception &e) {
+    }
+    throw std::invalid_argument("Invalid number of workers: " + count + ", please give a whole number.");
+}
+
+std::string getCacheDir(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("cache_dir")) {
+        return "";
+    }
+
+    std::string folder = parserResult.parsed("cache_dir").back().asString();
+    // remove the trailing slash, entries are joined on with one
+    while (folder.size() > 1 && folder.back() == '/') {
+        folder.pop_back();
+    }
+    return folder;
+}
+
+long getCacheMaxBytes(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("cache_max_mb")) {
+        return 0;
+    }
+
+    std::string megabytes = parserResult.parsed("cache_max_mb").back().asString();
+    try {
+        size_t end;
+        long parsed = std::stol(megabytes, &end);
+        if (end == megabytes.size() && parsed > 0) {
+            return parsed * 1024 * 1024;
+        }
+    } catch (std::exception &e) {
+    }
+    throw std::invalid_argument("Invalid cache size: " + megabytes + ", please give a whole number of megabytes.");
+}
+
+uint32_t getMaxNodes(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("max_nodes")) {
+        return 0;
+    }
+
+    std::string count = parserResult.parsed("max_nodes").back().asString();
+    try {
+        size_t end;
+        long parsed = std::stol(count, &end);
+        if (end == count.size() && parsed > 0 && parsed <= UINT32_MAX) {
+            return parsed;
+        }
+    } catch (std::exception &e) {
+    }
+    throw std::invalid_argument("Invalid node budget: " + count + ", please give a whole number of nodes.");
+}
+
+std::vector<GraphConfig> getGraphConfigs(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("configs")) {
+        return {};
+    }
+
+    std::vector<std::string> entries;
+    boost::algorithm::split(entries, parserResult.parsed("configs").back().asString(), boost::is_any_of(","));
+
+    std::vector<GraphConfig> configs;
+    for (const std::string &entry : entries) {
+        GraphConfig config;
+        config.graphType = std::to_string(configs.size());
+
+        size_t equals = entry.find('=');
+        if (equals == std::string::npos) {
+            config.name = entry;
+            for (auto &namedConfig : CONFIGS) {
+                if (namedConfig.first == entry) {
+                    config.args = namedConfig.second;
+                }
+            }
+            if (config.args.empty()) {
+                throw std::invalid_argument("Unknown config: " + entry +
+                                            ", please use base, opt or name=switch+switch.");
+            }
+        } else {
+            config.name = entry.substr(0, equals);
+            boost::algorithm::split(config.args, entry.substr(equals + 1), boost::is_any_of("+"));
+
+            for (const std::string &arg : config.args) {
+                bool known = false;
+                for (auto &argTuple : ARGS) {
+                    known |= argTuple.first == arg;
+                }
+                // where the graph goes is the same for every config
+                if (!known || arg == MAKE_DOT || arg == MAKE_PDF) {
+                    throw std::invalid_argument("Unknown switch in config " + config.name + ": " + arg);
+                }
+            }
+        }
+
+        // the name goes in the file names
+        if (config.name.empty() || config.name.find('/') != std::string::npos) {
+            throw std::invalid_argument("Invalid config name: " + config.name);
+        }
+        for (const GraphConfig &other : configs) {
+            if (other.name == config.name) {
+                throw std::invalid_argument("Config " + config.name + " is given twice");
+            }
+        }
+        configs.push_back(config);
+    }
+    return configs;
+}
+
+double getDesignTimeout(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("design_timeout")) {
+        return 0;
+    }
+
+    std::string seconds = parserResult.parsed("design_timeout").back().asString();
+    try {
+        size_t end;
+        double parsed = std::stod(seconds, &end);
+        if (end == seconds.size() && parsed > 0) {
+            return parsed;
+        }
+    } catch (std::exception &e) {
+    }
+    throw std::invalid_argument("Invalid design timeout: " + seconds + ", please give a number of seconds.");
+}
+
+long getDesignMaxRssKB(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("design_max_rss")) {
+        return 0;
+    }
+
+    std::string megabytes = parserResult.parsed("design_max_rss").back().asString();
+    try {
+        size_t end;
+        long parsed = std::stol(megabytes, &end);
+        if (end == megabytes.size() && parsed > 0) {
+            return parsed * 1024;
+        }
+    } catch (std::exception &e) {
+    }
+    throw std::invalid_argument("Invalid design memory limit: " + megabytes +
+                                ", please give a whole number of megabytes.");
+}
+
+std::string getProfileFile(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("profile")) {
+        return "";
+    }
+    return parserResult.parsed("profile").back().asString();
+}
+
+std::string getVitisDirectivesFile(Sawyer::CommandLine::ParserResult parserResult) {
+    if (!parserResult.have("vitis_directives")) {
+        return "";
+    }
+    return parserResult.parsed("vitis_directives").back().asString();
+}
+
 } // namespace CommandLine
 } // namespace Balor
\ No newline at end of file
@@ -4,9 +4,11 @@
 
 #include <Rose/CommandLine.h>
 
+#include <cstdint>
 #include <vector>
 
 #include "rose.h"
+#include "graph/args.h"
 
 namespace Balor {
 namespace CommandLine {
@@ -24,6 +26,46 @@ std::string getTopLevelFunctionName(Sawyer::CommandLine::ParserResult parserResu
 // Extract where to save output files to
 std::string getOutputsFolder(Sawyer::CommandLine::ParserResult parserResult);
 
+// Extract the output formats, dot or bin, defaults to dot
+std::vector<std::string> getOutputFormats(Sawyer::CommandLine::ParserResult parserResult);
+
+// Extract the batch manifest, empty if not running in batch mode
+std::string getBatchManifest(Sawyer::CommandLine::ParserResult parserResult);
+
+// Extract the socket to serve requests on, empty if serving on stdin
+std::string getServeSocket(Sawyer::CommandLine::ParserResult parserResult);
+
+// Extract the jobs file to drive, empty if not driving
+std::string getDriveJobs(Sawyer::CommandLine::ParserResult parserResult);
+
+// Extract the number of worker processes of --drive, defaults to the number of cores
+int getNumWorkers(Sawyer::CommandLine::ParserResult parserResult);
+
+// Extract the graph cache folder, empty if not caching
+std::string getCacheDir(Sawyer::CommandLine::ParserResult parserResult);
+
+// Extract the size limit of the graph cache in bytes, 0 if there isn't one
+long getCacheMaxBytes(Sawyer::CommandLine::ParserResult parserResult);
+
+// Extract the most nodes a graph can have, 0 if there is no budget
+uint32_t getMaxNodes(Sawyer::CommandLine::ParserResult parserResult);
+
+// Extract the graphs to generate from each parse, empty without --configs
+// the graph type of each is its place in the list, from 0
+std::vector<GraphConfig> getGraphConfigs(Sawyer::CommandLine::ParserResult parserResult);
+
+// Extract the longest a design can take to generate in seconds, 0 if there is no limit
+double getDesignTimeout(Sawyer::CommandLine::ParserResult parserResult);
+
+// Extract the largest the resident set can grow to while generating a design in kilobytes, 0 if there is no limit
+long getDesignMaxRssKB(Sawyer::CommandLine::ParserResult parserResult);
+
+// Extract the file to write the profile to, empty if not profiling
+std::string getProfileFile(Sawyer::CommandLine::ParserResult parserResult);
+
+// Extract the file of Vitis directives to insert into the kernel, empty if there isn't one
+std::string getVitisDirectivesFile(Sawyer::CommandLine::ParserResult parserResult);
+
 } // namespace CommandLine
 } // namespace Balor
 
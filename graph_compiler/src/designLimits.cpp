@@ -0,0 +1,83 @@
+#include "designLimits.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include <malloc.h>
+#include <unistd.h>
+
+namespace {
+
+struct DesignLimits {
+    bool active = false;
+    std::chrono::steady_clock::time_point deadline;
+    double seconds = 0;
+    long maxRssKB = 0;
+    int checksUntilRss = 0;
+};
+
+// the resident set is read from /proc once every this many checks
+const int RSS_CHECK_INTERVAL = 1024;
+
+thread_local DesignLimits limits;
+
+} // namespace
+
+namespace Balor {
+namespace Limits {
+
+long getRssKB() {
+    std::ifstream statm("/proc/self/statm");
+    long size = 0;
+    long resident = 0;
+    if (!(statm >> size >> resident)) {
+        return 0;
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+LimitExceeded::LimitExceeded(const std::string &reason, const std::string &message)
+    : std::runtime_error(message), reason(reason) {}
+
+Guard::Guard(double seconds, long maxRssKB) {
+    limits.active = seconds > 0 || maxRssKB > 0;
+    limits.seconds = seconds;
+    limits.maxRssKB = maxRssKB;
+    limits.deadline = std::chrono::steady_clock::now() +
+                      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                          std::chrono::duration<double>(seconds));
+    limits.checksUntilRss = 0;
+}
+
+Guard::~Guard() { limits.active = false; }
+
+void check() {
+    if (!limits.active) {
+        return;
+    }
+
+    if (limits.seconds > 0 && std::chrono::steady_clock::now() > limits.deadline) {
+        // only thrown once, the design is being given up on
+        limits.active = false;
+        std::ostringstream message;
+        message << "Design took longer than " << limits.seconds << " seconds";
+        throw LimitExceeded("timeout", message.str());
+    }
+
+    if (limits.maxRssKB > 0 && limits.checksUntilRss-- <= 0) {
+        limits.checksUntilRss = RSS_CHECK_INTERVAL;
+
+        long rssKB = getRssKB();
+        if (rssKB > limits.maxRssKB) {
+            limits.active = false;
+            throw LimitExceeded("memory", "Design used " + std::to_string(rssKB / 1024) + " MB, more than the limit of " +
+                                              std::to_string(limits.maxRssKB / 1024) + " MB");
+        }
+    }
+}
+
+void releaseMemory() { malloc_trim(0); }
+
+} // namespace Limits
+} // namespace Balor
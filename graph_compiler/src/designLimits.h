@@ -0,0 +1,42 @@
+#ifndef BALOR_DESIGN_LIMITS_H
+#define BALOR_DESIGN_LIMITS_H
+
+#include <stdexcept>
+#include <string>
+
+namespace Balor {
+namespace Limits {
+
+// Thrown at a checkpoint once the design being generated has taken too long or used too much memory,
+// the reason is "timeout" or "memory"
+class LimitExceeded : public std::runtime_error {
+  public:
+    LimitExceeded(const std::string &reason, const std::string &message);
+
+    const std::string reason;
+};
+
+// Limit the design generated on this thread while in scope, 0 for no limit
+// the memory limit is on the resident set of the whole process, so includes the parsed source
+class Guard {
+  public:
+    Guard(double seconds, long maxRssKB);
+    ~Guard();
+};
+
+// Throw LimitExceeded if the design has gone over its limits, called as the graph grows
+// only the clock is read on every call, the resident set every so many, so it is cheap enough for every node
+// a design is only stopped at a checkpoint, not part way through e.g. a ROSE call
+void check();
+
+// The current resident set of the process in kilobytes, 0 if it can't be read
+long getRssKB();
+
+// Give freed memory back to the system, after a design that went over its memory limit,
+// so the next design isn't measured against it
+void releaseMemory();
+
+} // namespace Limits
+} // namespace Balor
+
+#endif
@@ -0,0 +1,486 @@
+#include "drive.h"
+#include "batch.h"
+#include "commandLine.h"
+#include "profile.h"
+#include "serve.h"
+#include "graph/graphWriter.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// a worker gets this much longer than --design_timeout to answer, before it's taken to be stuck
+const double TIMEOUT_GRACE_SECONDS = 30;
+// and this much more on the first job of a kernel, which parses it, something the design limits don't cover
+const double PARSE_GRACE_SECONDS = 300;
+
+// A worker process and the job it is on
+struct Worker {
+    pid_t pid = -1;
+    std::unique_ptr<Balor::Serve::SocketChannel> channel;
+    std::string kernel;
+    // took the kernel from another worker, so takes its jobs from the end
+    bool helping = false;
+    Balor::Drive::Job job;
+    bool busy = false;
+    // when the worker is given up on, with --design_timeout
+    std::chrono::steady_clock::time_point deadline;
+};
+
+// the kernel of each job, with its job, in the order of the jobs file
+std::vector<std::pair<std::string, Balor::Drive::Job>> readJobs(const std::string &jobsFile) {
+    std::ifstream jobs(jobsFile);
+    if (!jobs) {
+        throw std::invalid_argument("Couldn't open jobs file: " + jobsFile);
+    }
+
+    std::vector<std::pair<std::string, Balor::Drive::Job>> kernelJobs;
+
+    std::string line;
+    int lineNum = 0;
+    while (std::getline(jobs, line)) {
+        lineNum++;
+
+        boost::algorithm::trim(line);
+        if (line.empty()) {
+            continue;
+        }
+
+        boost::property_tree::ptree tree;
+        try {
+            std::istringstream lineStream(line);
+            boost::property_tree::read_json(lineStream, tree);
+        } catch (boost::property_tree::json_parser_error e) {
+            throw std::invalid_argument("Couldn't parse line " + std::to_string(lineNum) + " of jobs file: " +
+                                        e.message());
+        }
+
+        Balor::Drive::Job job;
+        job.name = tree.get<std::string>("name", "");
+        if (job.name.empty()) {
+            throw std::invalid_argument("Job on line " + std::to_string(lineNum) + " of jobs file has no name");
+        }
+        job.request = line;
+
+        std::string kernel = tree.get<std::string>("src", "") + " " + tree.get<std::string>("top", "");
+        kernelJobs.push_back(std::make_pair(kernel, job));
+    }
+
+    return kernelJobs;
+}
+
+std::map<std::string, uint32_t> readSizes(const std::string &sizesFile) {
+    std::map<std::string, uint32_t> sizes;
+
+    std::ifstream sizesStream(sizesFile);
+    if (!sizesStream) {
+        return sizes;
+    }
+
+    try {
+        boost::property_tree::ptree tree;
+        boost::property_tree::read_json(sizesStream, tree);
+        for (auto &size : tree) {
+            sizes[size.first] = size.second.get_value<uint32_t>();
+        }
+    } catch (std::exception &e) {
+        // only decides the order, so a damaged file is started over
+        sizes.clear();
+    }
+    return sizes;
+}
+
+void writeSizes(const std::string &sizesFile, const std::map<std::string, uint32_t> &sizes) {
+    boost::property_tree::ptree tree;
+    for (auto &size : sizes) {
+        // kernels have dots in them, which put would take as a path
+        tree.push_back(std::make_pair(size.first, boost::property_tree::ptree(std::to_string(size.second))));
+    }
+
+    std::ofstream sizesStream(sizesFile);
+    boost::property_tree::write_json(sizesStream, tree);
+}
+
+// Fork a worker that answers requests on its end of a socket pair until the driver closes the other
+bool startWorker(Worker &worker, const std::vector<Worker> &workers, const Balor::Serve::Defaults &defaults) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return false;
+    }
+
+    // anything buffered would be written by both processes
+    std::cout.flush();
+    std::cerr.flush();
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        // the other workers only see the driver close their sockets if this one doesn't have them open
+        for (const Worker &other : workers) {
+            if (other.channel) {
+                close(other.channel->getFD());
+            }
+        }
+
+        // the worker's phases are its own, in <profile>.worker<pid>, the driver's profile only has the driver's
+        if (Balor::Profile::isEnabled()) {
+            Balor::Profile::restart(Balor::Profile::getOutputFile() + ".worker" + std::to_string(getpid()));
+        }
+
+        Balor::Serve::CompilerSession session;
+        Balor::Serve::SocketChannel channel(fds[1]);
+        try {
+            Balor::Serve::serveChannel(session, channel, defaults);
+        } catch (std::exception &e) {
+            std::cerr << e.what() << std::endl;
+        }
+        // without the exit handlers, which are the driver's
+        Balor::Profile::write();
+        _exit(0);
+    }
+
+    close(fds[1]);
+    worker.pid = pid;
+    worker.channel = std::make_unique<Balor::Serve::SocketChannel>(fds[0]);
+    worker.kernel.clear();
+    worker.helping = false;
+    worker.busy = false;
+    return true;
+}
+
+void stopWorker(Worker &worker) {
+    if (worker.channel) {
+        close(worker.channel->getFD());
+        worker.channel.reset();
+    }
+    if (worker.pid > 0) {
+        waitpid(worker.pid, nullptr, 0);
+        worker.pid = -1;
+    }
+    worker.busy = false;
+}
+
+// Give the worker its next job, false if there are none left or the worker couldn't take one
+// a worker that stopped while idle never ran the job, so the job goes back on its kernel's queue
+// and the worker is started again, and left stopped if the new one can't take it either
+bool assignJob(Worker &worker, Balor::Drive::JobQueue &queue, const std::vector<Worker> &workers,
+               const Balor::Serve::Defaults &defaults, double designTimeout) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        std::string previousKernel = worker.kernel;
+        if (!queue.next(worker.kernel, worker.helping, worker.job)) {
+            return false;
+        }
+
+        double allowed =
+            designTimeout + TIMEOUT_GRACE_SECONDS + (worker.kernel != previousKernel ? PARSE_GRACE_SECONDS : 0);
+        worker.deadline = std::chrono::steady_clock::now() +
+                          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                              std::chrono::duration<double>(allowed));
+
+        try {
+            worker.channel->write(worker.job.request + "\n");
+            worker.busy = true;
+            return true;
+        } catch (std::runtime_error &e) {
+            std::cerr << "Worker stopped before it was given " << worker.job.name << ", starting another" << std::endl;
+            queue.putBack(worker.kernel, worker.helping, worker.job);
+            queue.release(worker.kernel);
+            stopWorker(worker);
+            if (attempt > 0 || !startWorker(worker, workers, defaults)) {
+                return false;
+            }
+        }
+    }
+    return false;
+}
+
+// Read the response to the worker's job, false if the worker stopped before answering
+bool readResponse(Worker &worker, boost::property_tree::ptree &header, std::string &graph) {
+    std::string headerLine;
+    if (!worker.channel->readLine(headerLine)) {
+        return false;
+    }
+
+    std::istringstream headerStream(headerLine);
+    boost::property_tree::read_json(headerStream, header);
+
+    if (header.get<std::string>("status", "") != "ok") {
+        return true;
+    }
+    return worker.channel->readBytes(header.get<size_t>("size"), graph);
+}
+
+} // namespace
+
+namespace Balor {
+namespace Drive {
+
+JobQueue::JobQueue(const std::vector<std::pair<std::string, Job>> &kernelJobs,
+                   const std::map<std::string, uint32_t> &sizes) {
+    for (auto &kernelJob : kernelJobs) {
+        if (!jobs.count(kernelJob.first)) {
+            kernelOrder.push_back(kernelJob.first);
+        }
+        jobs[kernelJob.first].push_back(kernelJob.second);
+        numJobs++;
+    }
+
+    // the largest kernels take the longest, so they can't be left until last
+    auto getSize = [&](const std::string &kernel) {
+        auto size = sizes.find(kernel);
+        return size == sizes.end() ? UINT32_MAX : size->second;
+    };
+    std::stable_sort(kernelOrder.begin(), kernelOrder.end(),
+                     [&](const std::string &a, const std::string &b) { return getSize(a) > getSize(b); });
+}
+
+bool JobQueue::next(std::string &kernel, bool &helping, Job &job) {
+    if (numJobs == 0) {
+        return false;
+    }
+
+    auto own = jobs.find(kernel);
+    if (own == jobs.end() || own->second.empty()) {
+        std::string nextKernel;
+
+        // a kernel nobody has started
+        for (const std::string &candidate : kernelOrder) {
+            if (!jobs[candidate].empty() && numWorkers[candidate] == 0) {
+                nextKernel = candidate;
+                break;
+            }
+        }
+
+        // help the kernel with the most jobs left
+        if (nextKernel.empty()) {
+            size_t mostJobs = 0;
+            for (const std::string &candidate : kernelOrder) {
+                if (jobs[candidate].size() > mostJobs) {
+                    nextKernel = candidate;
+                    mostJobs = jobs[candidate].size();
+                }
+            }
+        }
+
+        release(kernel);
+        kernel = nextKernel;
+        helping = numWorkers[kernel] > 0;
+        numWorkers[kernel]++;
+    }
+
+    // helpers take from the end, the kernel's own workers from the front
+    if (helping) {
+        job = jobs[kernel].back();
+        jobs[kernel].pop_back();
+        numJobs--;
+        return true;
+    }
+
+    job = jobs[kernel].front();
+    jobs[kernel].pop_front();
+    numJobs--;
+    return true;
+}
+
+void JobQueue::putBack(const std::string &kernel, bool helping, const Job &job) {
+    if (helping) {
+        jobs[kernel].push_back(job);
+    } else {
+        jobs[kernel].push_front(job);
+    }
+    numJobs++;
+}
+
+void JobQueue::release(const std::string &kernel) {
+    auto workers = numWorkers.find(kernel);
+    if (workers != numWorkers.end() && workers->second > 0) {
+        workers->second--;
+    }
+}
+
+int runDriver(Sawyer::CommandLine::ParserResult parserResult) {
+    std::string outputFolder = Balor::CommandLine::getOutputsFolder(parserResult);
+    std::string sizesFile = outputFolder + ".drive_sizes.json";
+    int numWorkers = Balor::CommandLine::getNumWorkers(parserResult);
+
+    std::vector<std::string> formats = Balor::CommandLine::getOutputFormats(parserResult);
+    if (formats.size() > 1) {
+        throw std::invalid_argument("Only one output format can be driven at a time");
+    }
+    std::string extension = makeGraphWriter(formats.front())->getExtension();
+
+    // jobs use the switches the driver was started with, as requests of --serve do
+    Serve::Defaults defaults = Serve::makeDefaults(parserResult);
+
+    // the workers keep to the limit themselves, the driver only stops one that is stuck past it
+    double designTimeout = Balor::CommandLine::getDesignTimeout(parserResult);
+
+    Batch::FailureManifest failureManifest(outputFolder);
+
+    std::map<std::string, uint32_t> sizes = readSizes(sizesFile);
+    JobQueue queue(readJobs(Balor::CommandLine::getDriveJobs(parserResult)), sizes);
+    size_t numJobs = queue.size();
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<Worker> workers(std::min<size_t>(numWorkers, numJobs));
+    for (Worker &worker : workers) {
+        if (!startWorker(worker, workers, defaults)) {
+            throw std::runtime_error("Couldn't start a worker process");
+        }
+    }
+
+    int failures = 0;
+    int running = 0;
+    for (Worker &worker : workers) {
+        if (worker.channel) {
+            assignJob(worker, queue, workers, defaults, designTimeout);
+        }
+        running += worker.busy;
+    }
+
+    while (running > 0) {
+        std::vector<pollfd> fds;
+        std::vector<Worker *> polled;
+        for (Worker &worker : workers) {
+            if (worker.busy) {
+                fds.push_back({worker.channel->getFD(), POLLIN, 0});
+                polled.push_back(&worker);
+            }
+        }
+
+        // until the first worker has to be given up on, without a timeout until one answers
+        int timeoutMs = -1;
+        if (designTimeout > 0) {
+            auto now = std::chrono::steady_clock::now();
+            auto firstDeadline = std::min_element(polled.begin(), polled.end(), [](Worker *a, Worker *b) {
+                                     return a->deadline < b->deadline;
+                                 });
+            timeoutMs = std::max<long>(
+                0, std::chrono::duration_cast<std::chrono::milliseconds>((*firstDeadline)->deadline - now).count() + 1);
+        }
+
+        if (poll(fds.data(), fds.size(), timeoutMs) < 0) {
+            continue;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < fds.size(); i++) {
+            Worker &worker = *polled[i];
+            bool stuck = designTimeout > 0 && !fds[i].revents && now >= worker.deadline;
+            if (!fds[i].revents && !stuck) {
+                continue;
+            }
+            worker.busy = false;
+            running--;
+
+            boost::property_tree::ptree header;
+            std::string graph;
+            bool answered = false;
+            if (!stuck) {
+                try {
+                    answered = readResponse(worker, header, graph);
+                } catch (boost::property_tree::ptree_error &e) {
+                    answered = false;
+                }
+            }
+
+            if (stuck) {
+                // e.g. in the frontend, or a loop that makes no nodes, where its own limits aren't checked
+                std::cerr << "Design " << worker.job.name << " failed: worker didn't answer in time" << std::endl;
+                failureManifest.add(worker.job.name, "timeout", "worker didn't answer within the design timeout");
+                failures++;
+
+                queue.release(worker.kernel);
+                kill(worker.pid, SIGKILL);
+                stopWorker(worker);
+                if (queue.size() > 0) {
+                    startWorker(worker, workers, defaults);
+                }
+            } else if (!answered) {
+                // e.g. the compiler crashed on the design, the job isn't tried again
+                std::cerr << "Design " << worker.job.name << " failed: worker stopped" << std::endl;
+                failureManifest.add(worker.job.name, "crash", "worker stopped");
+                failures++;
+
+                queue.release(worker.kernel);
+                stopWorker(worker);
+                // without a worker the other workers take its jobs
+                if (queue.size() > 0) {
+                    startWorker(worker, workers, defaults);
+                }
+            } else if (header.get<std::string>("status", "") != "ok") {
+                std::string message = header.get<std::string>("message", "");
+                std::cerr << "Design " << worker.job.name << " failed: " << message << std::endl;
+                failureManifest.add(worker.job.name, header.get<std::string>("reason", "error"), message);
+                failures++;
+            } else {
+                // written under another name first, so a graph in the folder is always complete
+                std::string fileName = outputFolder + worker.job.name + extension;
+                bool written;
+                {
+                    std::ofstream out(fileName + ".tmp", std::ios::binary);
+                    out << graph;
+                    out.close();
+                    written = static_cast<bool>(out);
+                }
+                if (!written || std::rename((fileName + ".tmp").c_str(), fileName.c_str()) != 0) {
+                    std::remove((fileName + ".tmp").c_str());
+                    std::cerr << "Design " << worker.job.name << " failed: couldn't write " << fileName << std::endl;
+                    failureManifest.add(worker.job.name, "error", "Couldn't write " + fileName);
+                    failures++;
+                } else if (auto nodes = header.get_optional<uint32_t>("nodes")) {
+                    sizes[worker.kernel] = std::max(sizes[worker.kernel], *nodes);
+                }
+            }
+
+            if (worker.channel) {
+                assignJob(worker, queue, workers, defaults, designTimeout);
+            }
+            running += worker.busy;
+        }
+    }
+
+    for (Worker &worker : workers) {
+        stopWorker(worker);
+    }
+
+    // left when no worker could be started again
+    if (queue.size() > 0) {
+        std::cerr << queue.size() << " designs weren't generated, no worker was left to generate them" << std::endl;
+        failures += queue.size();
+    }
+
+    writeSizes(sizesFile, sizes);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Generated " << numJobs - failures << " of " << numJobs << " graphs in " << seconds << " seconds with "
+              << workers.size() << " workers" << std::endl;
+
+    return failures;
+}
+
+} // namespace Drive
+} // namespace Balor
@@ -0,0 +1,60 @@
+#ifndef BALOR_DRIVE_H
+#define BALOR_DRIVE_H
+
+#include <Rose/CommandLine.h>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Balor {
+namespace Drive {
+
+// One graph to generate, a line of the jobs file
+// the request is handed to a worker as is, so it has everything a --serve request can
+struct Job {
+    std::string name;
+    std::string request;
+};
+
+// The jobs of each kernel, a source file and top level function, waiting for a worker
+//
+// a worker keeps taking jobs of the kernel it has, so it only parses the kernel once,
+// and when the kernel has none left it takes the largest kernel no worker has yet,
+// or, once every kernel has a worker, helps the kernel with the most jobs left, taking its jobs from the end
+// while the kernel's own workers take from the front
+class JobQueue {
+  public:
+    // kernels with more nodes, from earlier runs, are started first, kernels that haven't been seen before first of all
+    JobQueue(const std::vector<std::pair<std::string, Job>> &kernelJobs, const std::map<std::string, uint32_t> &sizes);
+
+    // false when there are no jobs left, kernel is the worker's kernel, and is changed when it moves to another,
+    // helping is whether the worker is helping with its kernel, and is set when it moves
+    bool next(std::string &kernel, bool &helping, Job &job);
+    // a job given to a worker that couldn't take it, where the worker took it from
+    void putBack(const std::string &kernel, bool helping, const Job &job);
+    // a worker that stopped, its kernel can be started by another worker again
+    void release(const std::string &kernel);
+
+    size_t size() const { return numJobs; }
+
+  private:
+    std::map<std::string, std::deque<Job>> jobs;
+    // kernels in the order they are started
+    std::vector<std::string> kernelOrder;
+    std::map<std::string, int> numWorkers;
+    size_t numJobs = 0;
+};
+
+// Generate the graph of every job with --workers processes, each a --serve session,
+// writing each graph to <outputFolder>/<name> as soon as it is done
+// the number of nodes of each kernel is kept in <outputFolder>/.drive_sizes.json for the next run
+// returns the number of jobs that failed
+int runDriver(Sawyer::CommandLine::ParserResult parserResult);
+
+} // namespace Drive
+} // namespace Balor
+
+#endif
@@ -2,6 +2,7 @@
 #define BALOR_ARGS_H
 
 #include <string>
+#include <vector>
 
 namespace {
 const std::string IGNORE_CONTROL_FLOW_DESC = "Don't add control flow edges to the graph.";
@@ -35,6 +36,18 @@ const std::string DONT_DISPLAY_TYPES_DESC = "Don't output absorbed type info on
 const std::string ADD_NUM_CALLS_DESC = "Add the number of calls and call-sites to nodes in sub-functions";
 const std::string ADD_SPECIFY_ADDRESS_NODES_DESC = "Add specify address nodes for array reads and writes";
 const std::string ADD_EXTERNAL_NODE_DESC = "Add external node to function call graph";
+const std::string ADD_CFG_DESC =
+    "Add the control flow graph between basic blocks, and the basic block of each node, to the output";
+const std::string ADD_LOOP_TREE_DESC =
+    "Add the loop nest to the output: the parent, tripcount, unroll factor and pipelining of each loop, "
+    "and the innermost loop of each node and basic block";
+const std::string INTERN_TYPES_DESC = "Share one type node between the edges of each type in a basic block, instead "
+                                      "of adding a type node per edge.";
+const std::string COMPACT_DESC = "Merge identical constants in each function, skip nodes that only pass control flow "
+                                 "on, and drop nodes without edges, after the graph is built.";
+const std::string REUSE_DEREFS_DESC = "Reuse array address calculations from enclosing basic blocks, until a variable "
+                                      "the address depends on is written. Without it they are only reused within a "
+                                      "basic block, whatever the block writes";
 } // namespace
 
 namespace Balor {
@@ -64,6 +77,11 @@ const std::string PROXY_PROGRAML = "proxy_programl";
 const std::string DONT_DISPLAY_TYPES = "no_type_display";
 const std::string ADD_NUM_CALLS = "add_num_calls";
 const std::string ADD_EXTERNAL_NODE = "add_external";
+const std::string ADD_CFG = "add_cfg";
+const std::string REUSE_DEREFS = "reuse_derefs";
+const std::string INTERN_TYPES = "intern_types";
+const std::string COMPACT = "compact";
+const std::string ADD_LOOP_TREE = "add_loop_tree";
 
 const std::pair<std::string, std::string> ARGS[] = {
     std::make_pair(IGNORE_CONTROL_FLOW, IGNORE_CONTROL_FLOW_DESC),
@@ -89,8 +107,33 @@ const std::pair<std::string, std::string> ARGS[] = {
     std::make_pair(DONT_DISPLAY_TYPES, DONT_DISPLAY_TYPES_DESC),
     std::make_pair(ADD_NODE_TYPE, ADD_NODE_TYPE_DESC),
     std::make_pair(ADD_NUM_CALLS, ADD_NUM_CALLS_DESC),
-    std::make_pair(ADD_EXTERNAL_NODE, ADD_EXTERNAL_NODE_DESC)
+    std::make_pair(ADD_EXTERNAL_NODE, ADD_EXTERNAL_NODE_DESC),
+    std::make_pair(ADD_CFG, ADD_CFG_DESC),
+    std::make_pair(REUSE_DEREFS, REUSE_DEREFS_DESC),
+    std::make_pair(INTERN_TYPES, INTERN_TYPES_DESC),
+    std::make_pair(COMPACT, COMPACT_DESC),
+    std::make_pair(ADD_LOOP_TREE, ADD_LOOP_TREE_DESC)
     };
+
+// with --max_nodes, the switches turned on one at a time until the graph fits,
+// in order of how much they lose
+const std::string GRAPH_REDUCTIONS[] = {REMOVE_SEXTS, REMOVE_SINGLE_TARGET_BRANCHES, ONLY_MEMORY_CONTROL_FLOW,
+                                        HIDE_VALUES, ABSORB_TYPES, ABSORB_PRAGMAS};
+
+// the named sets of switches --configs knows, the modes of run_graph_compiler.py
+const std::pair<std::string, std::vector<std::string>> CONFIGS[] = {
+    std::make_pair("base", std::vector<std::string>{PROXY_PROGRAML}),
+    std::make_pair("opt", std::vector<std::string>{ALLOCAS_TO_MEM_ELEMS, REMOVE_SEXTS, REMOVE_SINGLE_TARGET_BRANCHES,
+                                                   DROP_FUNC_CALL_PROC, ABSORB_TYPES, ABSORB_PRAGMAS})
+    };
+
+// One of the graphs --configs makes from a parse: the switches it is generated with on top of the command line's,
+// and the graph type it is tagged with
+struct GraphConfig {
+    std::string name;
+    std::vector<std::string> args;
+    std::string graphType;
+};
 } // namespace Balor
 
 #endif
\ No newline at end of file
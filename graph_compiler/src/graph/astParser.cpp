@@ -1,6 +1,7 @@
 #include "astParser.h"
 #include "args.h"
 #include "nodeUtils.h"
+#include "../profile.h"
 #include <cassert>
 
 namespace Balor {
@@ -38,7 +39,13 @@ void AstParser::catchBreakStatements() {
 void AstParser::handleBB(std::vector<SgStatement *> statements) {
 
     // we only reuse array dereferences inside the same BB
-    derefTracker->makeNewDerefMap();
+    // or, with reuse_derefs, inside the same BB and the BBs around it
+    bool reuseDerefs = graphGenerator->checkArg(REUSE_DEREFS);
+    if (reuseDerefs) {
+        derefTracker->enterScope();
+    } else {
+        derefTracker->makeNewDerefMap();
+    }
 
     // the code currently can handle a maximum of 1 return statement
     // per function
@@ -46,6 +53,15 @@ void AstParser::handleBB(std::vector<SgStatement *> statements) {
 
     // for each line of code in a basic block
     for (SgStatement *statement : statements) {
+        // loops are labelled for Vitis directives, the label itself isn't part of the graph
+        // the labelled statement is either kept in the label or is the next statement of the block
+        while (SgLabelStatement *label = isSgLabelStatement(statement)) {
+            statement = label->get_statement();
+        }
+        if (!statement) {
+            continue;
+        }
+
         if (SgPragmaDeclaration *pragmaDec = isSgPragmaDeclaration(statement)) {
             continue;
         }
@@ -102,7 +118,7 @@ void AstParser::handleBB(std::vector<SgStatement *> statements) {
                             Node *rhs = new FakeConstantNode("Array Initialization", var->getType());
                             Node *writeNode = writeExpression(varDec, rhs);
                             int numVals = init->get_initializers()->get_expressions().size();
-                            writeNode->unrollFactor.full *= numVals;
+                            writeNode->scaleUnrollFactor(numVals);
                             new ControlFlowEdge(writeNode);
                         }
 
@@ -161,13 +177,21 @@ void AstParser::handleBB(std::vector<SgStatement *> statements) {
             // other pragmas (pipeline) do
             pragmaParser->enterLoopCondition();
 
+            // the condition, body and increment are in the loop
+            graphGenerator->enterLoop();
+
             // store the next instruction that is executed
             // so that we can get back to it
             // when we want to re-execute the condition
             PreLoopEdge *preLoopEdge = new PreLoopEdge();
 
             graphGenerator->newBB();
-            derefTracker->makeNewDerefMap();
+            if (graphGenerator->checkArg(REUSE_DEREFS)) {
+                // the condition, body and increment run again after any of them writes
+                derefTracker->statementWrites(forStatement);
+            } else {
+                derefTracker->makeNewDerefMap();
+            }
 
             // we need the branch making control flow edges
             // and the comparison for adding pragma nodes to
@@ -194,6 +218,7 @@ void AstParser::handleBB(std::vector<SgStatement *> statements) {
             }
 
             graphGenerator->newBB();
+            graphGenerator->enterLoopBody();
             // handle the body of the for loop
             handleBB(bb->getStatementList());
 
@@ -220,6 +245,7 @@ void AstParser::handleBB(std::vector<SgStatement *> statements) {
             // to evaluate the condition,
             // and then mark the branch node as the predecessor
             new LoopBackEdge(preLoopEdge, branchNode);
+            graphGenerator->exitLoop();
 
             // unapply any pragmas from this bb
             pragmaParser->unstackPragmas();
@@ -227,7 +253,9 @@ void AstParser::handleBB(std::vector<SgStatement *> statements) {
             catchBreakStatements();
 
             graphGenerator->newBB();
-            derefTracker->makeNewDerefMap();
+            if (!graphGenerator->checkArg(REUSE_DEREFS)) {
+                derefTracker->makeNewDerefMap();
+            }
 
             // if its a while statement
         } else if (SgWhileStmt *whileStmt = isSgWhileStmt(statement)) {
@@ -240,12 +268,18 @@ void AstParser::handleBB(std::vector<SgStatement *> statements) {
 
             new ProgramlBranchEdge();
 
+            // the condition and body are in the loop
+            graphGenerator->enterLoop();
+
             // store the next instruction that is executed
             // so that we can get back to it
             // when we want to re-execute the condition
             PreLoopEdge *preLoopEdge = new PreLoopEdge();
 
             graphGenerator->newBB();
+            if (graphGenerator->checkArg(REUSE_DEREFS)) {
+                derefTracker->statementWrites(whileStmt);
+            }
             SgStatement *condStatement = whileStmt->get_condition();
             SgExprStatement *condExprStatement = isSgExprStatement(condStatement);
             assert(condExprStatement);
@@ -270,6 +304,7 @@ void AstParser::handleBB(std::vector<SgStatement *> statements) {
             }
 
             graphGenerator->newBB();
+            graphGenerator->enterLoopBody();
             // handle the body of the for loop
             handleBB(bb->getStatementList());
 
@@ -279,12 +314,15 @@ void AstParser::handleBB(std::vector<SgStatement *> statements) {
             // to evaluate the condition,
             // and then mark the branch node as the predecessor
             new LoopBackEdge(preLoopEdge, branchNode);
+            graphGenerator->exitLoop();
 
             // unapply any pragmas from this bb
             pragmaParser->unstackPragmas();
 
             catchBreakStatements();
-            derefTracker->makeNewDerefMap();
+            if (!graphGenerator->checkArg(REUSE_DEREFS)) {
+                derefTracker->makeNewDerefMap();
+            }
 
         } else if (SgDoWhileStmt *doWhileStmt = isSgDoWhileStmt(statement)) {
             throw std::runtime_error("Do While loops not currently supported");
@@ -380,6 +418,10 @@ void AstParser::handleBB(std::vector<SgStatement *> statements) {
         }
     }
 
+    if (reuseDerefs) {
+        derefTracker->exitScope();
+    }
+
     if (numberOfReturnStatements > 1) {
         throw std::runtime_error("A maximum of one return statement per function is supported");
     }
@@ -390,7 +432,7 @@ Node *AstParser::handleFunctionCall(SgFunctionCallExp *funcCall) {
     SgFunctionDeclaration *funcDec = Balor::getFuncDecFromCall(funcCall);
     if (graphGenerator->checkArg(INLINE_FUNCTIONS) && pragmaParser->parseInlinePragma(funcDec)) {
         SgFunctionDeclaration *currentFuncDec = graphGenerator->getFuncDec();
-        graphGenerator->registerCalls(funcDec, pragmaParser->getUnrollFactor().full);
+        pragmaParser->registerCall(funcDec);
         functionDecsComplete.insert(funcDec);
         graphGenerator->setFuncDec(funcDec);
         // start parameter index at 0
@@ -424,6 +466,12 @@ Node *AstParser::handleFunctionCall(SgFunctionCallExp *funcCall) {
         FunctionCallEdge *funcCallEdge = new FunctionCallEdge(funcCallNode, funcDec);
         functionDecsNeeded.push(funcDec);
 
+        // addresses calculated from anything the call can write can't be reused after it
+        // only with reuse_derefs, so the graphs of existing datasets don't change
+        if (graphGenerator->checkArg(REUSE_DEREFS)) {
+            derefTracker->callMade(funcCall);
+        }
+
         if (!decsToCalls.count(funcDec)) {
             decsToCalls[funcDec] = std::vector<FunctionCallNode *>();
         }
@@ -433,7 +481,7 @@ Node *AstParser::handleFunctionCall(SgFunctionCallExp *funcCall) {
             funcCallEdge->parameters.push_back(argExpr);
         }
 
-        funcCallNode->setType(funcDec->get_orig_return_type()->findBaseType()->unparseToString());
+        funcCallNode->setType(unparse(funcDec->get_orig_return_type()->findBaseType()));
 
         // when not inlined, dataflow edges come from the call node
         return funcCallNode;
@@ -595,7 +643,7 @@ Node *AstParser::readExpression(SgExpression *expr) {
         Node *constant = new ConstantNode(unsignedLongVal->get_value(), longType);
         return constant;
     } else if (SgCastExp *castExpr = isSgCastExp(expr)) {
-        std::string type = castExpr->get_type()->findBaseType()->unparseToString();
+        std::string type = unparse(castExpr->get_type()->findBaseType());
 
         Node *input = readExpression(castExpr->get_operand());
 
@@ -1109,6 +1157,12 @@ Node *AstParser::addWrite(Node *variable, Node *rhs, Node *typeDependency) {
 }
 
 Node *AstParser::writeExpression(SgNode *lhs, Node *rhs) {
+    // addresses calculated from the old value can't be reused
+    // only with reuse_derefs, so the graphs of existing datasets don't change
+    if (graphGenerator->checkArg(REUSE_DEREFS)) {
+        derefTracker->expressionWritten(lhs);
+    }
+
     // are we writing to a variable
     if (SgVarRefExp *varRef = isSgVarRefExp(lhs)) {
         // get the declaration
@@ -1282,6 +1336,7 @@ ReturnEdge *AstParser::getFunctionReturnEdge(SgFunctionDeclaration *funcDec) {
 }
 
 void AstParser::parseAst(SgFunctionDefinition *topLevelFuncDef) {
+    this->topLevelFuncDef = topLevelFuncDef;
     SgFunctionDeclaration *topLevelFuncDec = topLevelFuncDef->get_declaration();
     graphGenerator->setGroupName("External");
     graphGenerator->setFuncDec(topLevelFuncDec);
@@ -1296,7 +1351,10 @@ void AstParser::parseAst(SgFunctionDefinition *topLevelFuncDef) {
 
     graphGenerator->setGroupName(topLevelFuncDec->get_name());
 
-    handleFuncDec(topLevelFuncDec, external);
+    {
+        Profile::Phase phase("parseAst:" + topLevelFuncDec->get_name().getString());
+        handleFuncDec(topLevelFuncDec, external);
+    }
     // change how array parameters are handled
     // since top level array params are different
     variableMapper->finishedMain = true;
@@ -1319,8 +1377,7 @@ void AstParser::parseAst(SgFunctionDefinition *topLevelFuncDef) {
         graphGenerator->setGroupName(funcDec->get_name());
         graphGenerator->enterNewFunction();
 
-
-
+        Profile::Phase phase("parseAst:" + funcDec->get_name().getString());
         ReturnEdge *functionReturnEdge = handleFuncDec(funcDec, external);
 
 
@@ -1330,12 +1387,23 @@ void AstParser::parseAst(SgFunctionDefinition *topLevelFuncDef) {
 
     pragmaParser->parseInlinePragmas(functionDecsComplete);
 
+    markInlinedFunctions(true);
+    registerFunctionCalls();
+}
+
+void AstParser::markInlinedFunctions(bool addPragmaNodes) {
+    graphGenerator->resetFuncsInlined();
+
     while (!pragmaParser->inlinedFunctions.empty()) {
         SgFunctionDeclaration *funcDec = pragmaParser->inlinedFunctions.front();
         pragmaParser->inlinedFunctions.pop();
 
         graphGenerator->setFuncInlined(funcDec, true);
 
+        if (!addPragmaNodes) {
+            continue;
+        }
+
         Node *pragma = nullptr;
 
         //if the function was inlined on the graph, no call nodes
@@ -1349,15 +1417,16 @@ void AstParser::parseAst(SgFunctionDefinition *topLevelFuncDef) {
             }
         }
     }
+}
 
-
+void AstParser::registerFunctionCalls() {
+    SgFunctionDeclaration *topLevelFuncDec = topLevelFuncDef->get_declaration();
     graphGenerator->registerCalls(topLevelFuncDec, 1);
     for(SgFunctionDeclaration *funcDec : functionDecsComplete){
         for (FunctionCallNode *funcCall : decsToCalls[funcDec]) {
             graphGenerator->registerCalls(funcDec, funcCall->unrollFactor.full);
         }
     }    
-
 }
 
 } // namespace Balor
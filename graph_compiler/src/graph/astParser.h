@@ -37,6 +37,11 @@ class AstParser {
 
     void parseAst(SgFunctionDefinition *topLevelFuncDef);
 
+    // mark the functions the pragma parser found inline pragmas for
+    void markInlinedFunctions(bool addPragmaNodes);
+    // count the calls to each function, scaled by the unroll factor of the call
+    void registerFunctionCalls();
+
     void handleBB(std::vector<SgStatement *> statements);
     void catchBreakStatements();
 
@@ -85,6 +90,8 @@ class AstParser {
     std::set<SgInitializedName *> variableDeclarationsProcessed;
 
     Node *functionReturn = nullptr;
+
+    SgFunctionDefinition *topLevelFuncDef = nullptr;
 };
 } // namespace Balor
 
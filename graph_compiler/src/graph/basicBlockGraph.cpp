@@ -0,0 +1,65 @@
+#include "basicBlockGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace Balor {
+
+void BasicBlockGraph::clear() {
+    numBBs = 0;
+    edges.clear();
+    edgeSet.clear();
+    nodeBBs.clear();
+}
+
+void BasicBlockGraph::build(const FlatGraph &graph) {
+    clear();
+
+    const std::vector<int> &bbIDs = graph.getNodeBBIDs();
+    for (uint32_t node = 0; node < graph.getNumNodes(); node++) {
+        if (graph.isImplicit(node)) {
+            nodeBBs.push_back(-1);
+            continue;
+        }
+        nodeBBs.push_back(bbIDs[node] - 1);
+        numBBs = std::max(numBBs, bbIDs[node]);
+    }
+
+    const std::vector<uint32_t> &sources = graph.getEdgeSources();
+    const std::vector<uint32_t> &destinations = graph.getEdgeDestinations();
+    const std::vector<FlowType> &flowTypes = graph.getEdgeFlowTypes();
+    for (uint32_t edge = 0; edge < graph.getNumEdges(); edge++) {
+        if (flowTypes[edge] != FlowType::CONTROL && flowTypes[edge] != FlowType::CALL) {
+            continue;
+        }
+
+        uint32_t source = sources[edge];
+        uint32_t destination = destinations[edge];
+        if (graph.isImplicit(source) || graph.isImplicit(destination)) {
+            const std::vector<int> &printIDs = graph.getNodePrintIDs();
+            throw std::runtime_error("Control flow edge has a node that was never printed: node" +
+                                     std::to_string(printIDs[source]) + " -> node" +
+                                     std::to_string(printIDs[destination]));
+        }
+
+        addEdge(nodeBBs[source], nodeBBs[destination]);
+    }
+}
+
+void BasicBlockGraph::addEdge(int sourceBB, int targetBB) {
+    // only control flow between different BBs
+    if (sourceBB == targetBB) {
+        return;
+    }
+
+    // the cfg is used bidirectionally, so an edge back is the same edge
+    if (edgeSet.count(std::make_pair(targetBB, sourceBB)) || edgeSet.count(std::make_pair(sourceBB, targetBB))) {
+        return;
+    }
+
+    edgeSet.insert(std::make_pair(sourceBB, targetBB));
+    edges.push_back(std::make_pair(sourceBB, targetBB));
+}
+
+} // namespace Balor
@@ -0,0 +1,39 @@
+#ifndef BALOR_BASIC_BLOCK_GRAPH_H
+#define BALOR_BASIC_BLOCK_GRAPH_H
+
+#include "flatGraph.h"
+
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace Balor {
+
+// The control flow graph between basic blocks, from the control flow and call edges of the printed graph
+// BB indices are bbID - 1, as the first basic block has ID 1
+class BasicBlockGraph {
+  public:
+    void clear();
+
+    void build(const FlatGraph &graph);
+
+    int getNumBBs() { return numBBs; }
+
+    // each edge once, in the direction it was first seen
+    const std::vector<std::pair<int, int>> &getEdges() { return edges; }
+
+    // the BB index of each node, in the order of the flat graph, -1 for nodes that were never written
+    const std::vector<int> &getNodeBBs() { return nodeBBs; }
+
+  private:
+    int numBBs = 0;
+    std::vector<std::pair<int, int>> edges;
+    std::set<std::pair<int, int>> edgeSet;
+    std::vector<int> nodeBBs;
+
+    void addEdge(int sourceBB, int targetBB);
+};
+
+} // namespace Balor
+
+#endif
@@ -1,19 +1,246 @@
 #include "derefTracker.h"
+#include "../utility.h"
+#include "nodeUtils.h"
+#include "variableMapper.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace Balor {
 
-void DerefTracker::makeNewDerefMap() { derefsToDerefNode = std::map<std::string, DerefNode *>(); }
+void DerefTracker::makeNewDerefMap() { derefsToDerefNode.clear(); }
 
 DerefNode *DerefTracker::getDerefNode(SgBinaryOp *arrayIndex) {
-    std::string derefString = arrayIndex->unparseToString();
-    if (derefsToDerefNode.count(derefString)) {
-        return derefsToDerefNode[derefString];
+    auto saved = derefsToDerefNode.find(makeKey(arrayIndex, nullptr));
+    if (saved != derefsToDerefNode.end()) {
+        return saved->second.deref;
     }
     return nullptr;
 }
 
 void DerefTracker::saveDerefNode(SgBinaryOp *arrayIndex, DerefNode *deref) {
-    derefsToDerefNode[arrayIndex->unparseToString()] = deref;
+    SavedDeref saved;
+    saved.deref = deref;
+    saved.depth = depth;
+
+    DerefKey key = makeKey(arrayIndex, &saved);
+    derefsToDerefNode[std::move(key)] = std::move(saved);
+}
+
+void DerefTracker::enterScope() { depth++; }
+
+void DerefTracker::exitScope() {
+    for (auto saved = derefsToDerefNode.begin(); saved != derefsToDerefNode.end();) {
+        if (saved->second.depth >= depth) {
+            saved = derefsToDerefNode.erase(saved);
+        } else {
+            saved++;
+        }
+    }
+    depth--;
+}
+
+DerefTracker::DerefKey DerefTracker::makeKey(SgBinaryOp *arrayIndex, SavedDeref *saved) {
+    DerefKey key;
+    addTokens(arrayIndex, true, key, saved);
+
+    // FNV-1a over the tokens
+    uint64_t hash = 14695981039346656037ull;
+    for (uintptr_t token : key.tokens) {
+        hash = (hash ^ token) * 1099511628211ull;
+    }
+    key.hash = hash;
+    return key;
+}
+
+// isAddress is true for the array being indexed, e.g. a and a[i] in a[i][j],
+// and false for anything whose value is used, e.g. i and j
+void DerefTracker::addTokens(SgExpression *expr, bool isAddress, DerefKey &key, SavedDeref *saved) {
+    key.tokens.push_back(expr->variantT());
+
+    if (SgVarRefExp *varRef = isSgVarRefExp(expr)) {
+        // inlined parameters are the variable passed to them
+        SgInitializedName *variable = variableMapper->getUnderlyingVariable(varRef->get_symbol()->get_declaration());
+        key.tokens.push_back(reinterpret_cast<uintptr_t>(variable));
+        if (saved) {
+            saved->variables.insert(variable);
+        }
+    } else if (SgPntrArrRefExp *arrayRef = isSgPntrArrRefExp(expr)) {
+        if (saved && (!isAddress || !isSgArrayType(arrayRef->get_type()->stripTypedefsAndModifiers()))) {
+            // reading an element, rather than moving along an array of arrays
+            if (SgInitializedName *base = getBaseVariable(arrayRef)) {
+                saved->memory.insert(base);
+            } else {
+                saved->unknownMemory = true;
+            }
+        }
+        addTokens(arrayRef->get_lhs_operand(), isAddress, key, saved);
+        addTokens(arrayRef->get_rhs_operand(), false, key, saved);
+    } else if (expr->variantT() == V_SgPointerDerefExp || expr->variantT() == V_SgDotExp ||
+               expr->variantT() == V_SgArrowExp) {
+        if (saved) {
+            if (SgInitializedName *base = getBaseVariable(expr)) {
+                saved->memory.insert(base);
+            } else {
+                saved->unknownMemory = true;
+            }
+        }
+        if (SgBinaryOp *binaryOp = isSgBinaryOp(expr)) {
+            addTokens(binaryOp->get_lhs_operand(), isAddress, key, saved);
+            addTokens(binaryOp->get_rhs_operand(), isAddress, key, saved);
+        } else {
+            addTokens(isSgUnaryOp(expr)->get_operand(), isAddress, key, saved);
+        }
+    } else if (SgCastExp *cast = isSgCastExp(expr)) {
+        // the type decides how constants and reads are printed
+        key.tokens.push_back(reinterpret_cast<uintptr_t>(cast->get_type()));
+        addTokens(cast->get_operand(), isAddress, key, saved);
+    } else if (SgBinaryOp *binaryOp = isSgBinaryOp(expr)) {
+        addTokens(binaryOp->get_lhs_operand(), false, key, saved);
+        addTokens(binaryOp->get_rhs_operand(), false, key, saved);
+    } else if (SgUnaryOp *unaryOp = isSgUnaryOp(expr)) {
+        addTokens(unaryOp->get_operand(), false, key, saved);
+    } else if (SgIntVal *intVal = isSgIntVal(expr)) {
+        key.tokens.push_back(intVal->get_value());
+    } else if (SgLongIntVal *longIntVal = isSgLongIntVal(expr)) {
+        key.tokens.push_back(longIntVal->get_value());
+    } else if (SgLongLongIntVal *longLongIntVal = isSgLongLongIntVal(expr)) {
+        key.tokens.push_back(longLongIntVal->get_value());
+    } else if (SgUnsignedLongVal *unsignedLongVal = isSgUnsignedLongVal(expr)) {
+        key.tokens.push_back(unsignedLongVal->get_value());
+    } else if (SgBoolValExp *boolVal = isSgBoolValExp(expr)) {
+        key.tokens.push_back(boolVal->get_value());
+    } else if (SgDoubleVal *doubleVal = isSgDoubleVal(expr)) {
+        double value = doubleVal->get_value();
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        key.tokens.push_back(bits);
+    } else if (SgValueExp *valueExp = isSgValueExp(expr)) {
+        // every other constant, e.g. 1u, 'a' or 1.0f, by its text, the variant already tells the kinds apart
+        // literals are short, so this is still far cheaper than unparsing the whole access
+        std::string text = unparse(valueExp);
+        key.tokens.push_back(text.size());
+        for (size_t offset = 0; offset < text.size(); offset += sizeof(uintptr_t)) {
+            uintptr_t chunk = 0;
+            std::memcpy(&chunk, text.data() + offset, std::min(sizeof(chunk), text.size() - offset));
+            key.tokens.push_back(chunk);
+        }
+    } else if (SgFunctionCallExp *call = isSgFunctionCallExp(expr)) {
+        // a call can return something different each time, so its result is never shared
+        key.tokens.push_back(reinterpret_cast<uintptr_t>(call));
+        if (saved) {
+            saved->unknownMemory = true;
+        }
+    } else {
+        // anything else is only the same as itself
+        key.tokens.push_back(reinterpret_cast<uintptr_t>(expr));
+    }
+}
+
+// the variable an array, pointer or struct access starts from, e.g. a in a[i].x
+// null if it doesn't start from one
+SgInitializedName *DerefTracker::getBaseVariable(SgExpression *expr) {
+    while (true) {
+        if (SgVarRefExp *varRef = isSgVarRefExp(expr)) {
+            return variableMapper->getUnderlyingVariable(varRef->get_symbol()->get_declaration());
+        } else if (SgBinaryOp *binaryOp = isSgBinaryOp(expr)) {
+            if (!isSgPntrArrRefExp(expr) && expr->variantT() != V_SgDotExp && expr->variantT() != V_SgArrowExp) {
+                return nullptr;
+            }
+            expr = binaryOp->get_lhs_operand();
+        } else if (SgUnaryOp *unaryOp = isSgUnaryOp(expr)) {
+            if (!isSgPointerDerefExp(expr) && !isSgCastExp(expr)) {
+                return nullptr;
+            }
+            expr = unaryOp->get_operand();
+        } else {
+            return nullptr;
+        }
+    }
+}
+
+void DerefTracker::variableWritten(SgInitializedName *variable) {
+    for (auto saved = derefsToDerefNode.begin(); saved != derefsToDerefNode.end();) {
+        if (saved->second.variables.count(variable)) {
+            saved = derefsToDerefNode.erase(saved);
+        } else {
+            saved++;
+        }
+    }
+}
+
+void DerefTracker::memoryWritten(SgInitializedName *variable) {
+    for (auto saved = derefsToDerefNode.begin(); saved != derefsToDerefNode.end();) {
+        if (saved->second.unknownMemory || saved->second.memory.count(variable)) {
+            saved = derefsToDerefNode.erase(saved);
+        } else {
+            saved++;
+        }
+    }
+}
+
+void DerefTracker::allMemoryWritten() {
+    for (auto saved = derefsToDerefNode.begin(); saved != derefsToDerefNode.end();) {
+        if (saved->second.unknownMemory || !saved->second.memory.empty()) {
+            saved = derefsToDerefNode.erase(saved);
+        } else {
+            saved++;
+        }
+    }
+}
+
+void DerefTracker::expressionWritten(SgNode *lhs) {
+    if (SgInitializedName *varDec = isSgInitializedName(lhs)) {
+        variableWritten(variableMapper->getUnderlyingVariable(varDec));
+    } else if (SgVarRefExp *varRef = isSgVarRefExp(lhs)) {
+        variableWritten(variableMapper->getUnderlyingVariable(varRef->get_symbol()->get_declaration()));
+    } else if (SgExpression *expr = isSgExpression(lhs)) {
+        // an element of an array, a pointer or a struct
+        if (SgInitializedName *base = getBaseVariable(expr)) {
+            memoryWritten(base);
+        } else {
+            allMemoryWritten();
+        }
+    }
+}
+
+// a call could write anything it was given the address of, and any global variable
+void DerefTracker::callMade(SgFunctionCallExp *call) {
+    allMemoryWritten();
+
+    for (auto saved = derefsToDerefNode.begin(); saved != derefsToDerefNode.end();) {
+        bool readsGlobal = false;
+        for (SgInitializedName *variable : saved->second.variables) {
+            readsGlobal = readsGlobal || isSgGlobal(variable->get_scope());
+        }
+        if (readsGlobal) {
+            saved = derefsToDerefNode.erase(saved);
+        } else {
+            saved++;
+        }
+    }
+
+    SgFunctionDeclaration *funcDec = getFuncDecFromCall(call);
+    SgExpressionPtrList &args = call->get_args()->get_expressions();
+    for (size_t i = 0; i < args.size() && i < funcDec->get_args().size(); i++) {
+        if (isSgReferenceType(funcDec->get_args()[i]->get_type())) {
+            expressionWritten(args[i]);
+        }
+    }
+}
+
+void DerefTracker::statementWrites(SgStatement *statement) {
+    for (SgNode *node : querySubTree(statement, V_SgExpression)) {
+        SgExpression *expr = isSgExpression(node);
+        if (expr->variantT() == V_SgAssignOp || Utils::isUpdateOp(expr->variantT())) {
+            expressionWritten(isSgBinaryOp(expr)->get_lhs_operand());
+        } else if (Utils::isIncOrDecOp(expr->variantT())) {
+            expressionWritten(isSgUnaryOp(expr)->get_operand());
+        } else if (SgFunctionCallExp *call = isSgFunctionCallExp(expr)) {
+            // the body of an inlined function isn't under the statement, so assume the worst of every call
+            callMade(call);
+        }
+    }
 }
 
-} // namespace Balor
\ No newline at end of file
+} // namespace Balor
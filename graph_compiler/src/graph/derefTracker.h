@@ -4,24 +4,82 @@
 #include "node.h"
 #include "rose.h"
 
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 namespace Balor {
 
 class DerefNode;
 class ExpandableEdge;
 class GraphGenerator;
+class VariableMapper;
 
+// Array dereferences already in the graph, so the same address isn't calculated twice
+//
+// dereferences are matched by the structure of the array expression, its variables, operators and constants,
+// and a saved dereference is dropped as soon as a variable its address depends on is written
 class DerefTracker {
   public:
-    DerefTracker() {}
+    DerefTracker(VariableMapper *variableMapper) : variableMapper(variableMapper) {}
     DerefNode *getDerefNode(SgBinaryOp *arrayIndex);
     void saveDerefNode(SgBinaryOp *arrayIndex, DerefNode *deref);
 
     void makeNewDerefMap();
 
+    // with --reuse_derefs basic blocks nest instead of starting from nothing,
+    // a block can reuse the dereferences of the blocks around it, and its own are dropped when it ends
+    void enterScope();
+    void exitScope();
+
+    // the expression is written to, e.g. the lhs of an assignment, these are only reported with --reuse_derefs
+    void expressionWritten(SgNode *lhs);
+    // a call that isn't inlined, so what it writes isn't seen
+    void callMade(SgFunctionCallExp *call);
+    // drop every dereference the statement could change when it runs, e.g. a loop before it repeats
+    void statementWrites(SgStatement *statement);
+
   private:
-    std::map<std::string, DerefNode *> derefsToDerefNode;
+    // the structure of an array expression, the variant of each AST node in pre-order
+    // followed by whatever makes it different from another node of that variant, e.g. a constant's value
+    struct DerefKey {
+        std::vector<uintptr_t> tokens;
+        size_t hash = 0;
+
+        bool operator==(const DerefKey &other) const { return hash == other.hash && tokens == other.tokens; }
+    };
+
+    struct DerefKeyHash {
+        size_t operator()(const DerefKey &key) const { return key.hash; }
+    };
+
+    struct SavedDeref {
+        DerefNode *deref = nullptr;
+        // the number of scopes open when it was saved
+        size_t depth = 0;
+
+        // variables whose values the address depends on
+        std::unordered_set<SgInitializedName *> variables;
+        // arrays and pointers whose memory the address depends on, e.g. b in a[b[i]]
+        std::unordered_set<SgInitializedName *> memory;
+        // memory that can't be tied to a variable, e.g. the result of a call
+        bool unknownMemory = false;
+    };
+
+    DerefKey makeKey(SgBinaryOp *arrayIndex, SavedDeref *saved);
+    void addTokens(SgExpression *expr, bool isAddress, DerefKey &key, SavedDeref *saved);
+    SgInitializedName *getBaseVariable(SgExpression *expr);
+
+    void variableWritten(SgInitializedName *variable);
+    void memoryWritten(SgInitializedName *variable);
+    void allMemoryWritten();
+
+    VariableMapper *variableMapper;
+    std::unordered_map<DerefKey, SavedDeref, DerefKeyHash> derefsToDerefNode;
+    size_t depth = 0;
 };
 
 } // namespace Balor
 
-#endif
\ No newline at end of file
+#endif
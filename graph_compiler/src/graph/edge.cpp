@@ -1,36 +1,67 @@
 #include "edge.h"
+#include "../designLimits.h"
+#include "../utility.h"
 #include "args.h"
 
 namespace Balor {
 
-GraphGenerator *Edges::graphGenerator = nullptr;
-Node *Edges::previousControlFlowNode = nullptr;
-std::queue<Edge *> Edges::previousControlFlowNodeChangeListeners;
+std::string getVariantName(EdgeVariant variant) {
+    return variant == EdgeVariant::CONTROL_FLOW ? "CONTROL_FLOW" : "DEFAULT";
+}
+
+thread_local GraphGenerator *Edges::graphGenerator = nullptr;
 
-Node *Edges::getPreviousControlFlowNode() { return previousControlFlowNode; }
+Node *Edges::getPreviousControlFlowNode() { return graphGenerator->buildState.previousControlFlowNode; }
 
 // when you add a node to the control flow
 // sometimes other nodes care about what the next node is
 // so you have to update the listeners after changing the control flow
 // so they can react appropriately
 void Edges::updatePreviousControlFlowNode(Node *node) {
-    previousControlFlowNode = node;
-    while (!previousControlFlowNodeChangeListeners.empty()) {
-        Edge *listener = previousControlFlowNodeChangeListeners.front();
-        previousControlFlowNodeChangeListeners.pop();
+    GraphGenerator::BuildState &buildState = graphGenerator->buildState;
+    buildState.previousControlFlowNode = node;
+    while (!buildState.previousControlFlowNodeChangeListeners.empty()) {
+        Edge *listener = buildState.previousControlFlowNodeChangeListeners.front();
+        buildState.previousControlFlowNodeChangeListeners.pop();
         listener->runDeferred();
     }
 }
 
-void Edges::addPreviousControlFlowNodeChangeListener(Edge *edge) { previousControlFlowNodeChangeListeners.push(edge); }
+void Edges::addPreviousControlFlowNodeChangeListener(Edge *edge) {
+    graphGenerator->buildState.previousControlFlowNodeChangeListeners.push(edge);
+}
+
+void Edges::resetControlFlow() {
+    graphGenerator->buildState.previousControlFlowNode = nullptr;
+    graphGenerator->buildState.previousControlFlowNodeChangeListeners = std::queue<Edge *>();
+}
+
+Node *Edges::getTypeNode(TypeStruct type, bool constant) {
+    std::map<std::tuple<std::string, bool, int>, Node *> &typeNodes = graphGenerator->buildState.typeNodes;
+    std::tuple<std::string, bool, int> key(type.toString(), constant, graphGenerator->getBBID());
+
+    if (graphGenerator->checkArg(INTERN_TYPES) && typeNodes.count(key)) {
+        return typeNodes[key];
+    }
+
+    Node *typeNode = new TypeNode(type, constant);
+    typeNode->print();
+
+    if (graphGenerator->checkArg(INTERN_TYPES)) {
+        typeNodes[key] = typeNode;
+    }
+    return typeNode;
+}
+
+void *Edge::operator new(size_t size) { return Edges::graphGenerator->arena->allocate(size); }
 
 Edge::Edge(Node *source, Node *destination) : source(source), destination(destination) {
+    Limits::check();
+
     Edges::graphGenerator->edges.push_back(this);
 
-    // give to unique pointer to manage memory automatically
-    std::unique_ptr<Edge> edge_unique = std::unique_ptr<Edge>(this);
-    // pass to vector on object so it passes out of scope at the right time
-    Edges::graphGenerator->edges_unq.push_back(std::move(edge_unique));
+    // the graph generator destroys it along with the graph
+    Edges::graphGenerator->allocatedEdges.push_back(this);
 }
 
 WriteMemoryElementEdge::WriteMemoryElementEdge(Node *source, Node *destination) : Edge(source, destination) {
@@ -123,9 +154,7 @@ void DataFlowEdge::run() {
     if (typeToDest) {
         TypeStruct sourceType = source->getImmediateType();
 
-        Node *typeNode = new TypeNode(sourceType, sourceIsConstant);
-        typeNode->print();
-
+        Node *typeNode = Edges::getTypeNode(sourceType, sourceIsConstant);
 
         Edges::printSubDataFlowEdge(typeNode, destination, order);
         if (sourceToType) {
@@ -200,11 +229,9 @@ void MemoryAddressEdge::run() {
 
         Node *typeNode;
         if (!Edges::graphGenerator->checkArg(ALLOCAS_TO_MEM_ELEMS)) {
-            typeNode = new TypeNode(source->getImmediateType(), sourceIsConstant);
-            typeNode->print();
+            typeNode = Edges::getTypeNode(source->getImmediateType(), sourceIsConstant);
         } else {
-            typeNode = new TypeNode(getElemType(), sourceIsConstant);
-            typeNode->print();
+            typeNode = Edges::getTypeNode(getElemType(), sourceIsConstant);
         }
 
         Edges::printSubMemoryAddressEdge(typeNode, destination);
@@ -219,8 +246,7 @@ void MemoryAddressEdge::run() {
 void SpecifyAddressEdge::run() {
     Edges::graphGenerator->stateNode = destination;
     if (!Edges::graphGenerator->checkArg(ABSORB_TYPES)) {
-        Node *typeNode = new TypeNode(source->getType(), false);
-        typeNode->print();
+        Node *typeNode = Edges::getTypeNode(source->getType(), false);
 
         Edges::printSubMemoryAddressEdge(source, typeNode);
         Edges::printSubMemoryAddressEdge(typeNode, destination);
@@ -421,7 +447,7 @@ void ReturnEdge::run() {
     // might need a cast e.g. the calculated value is an int but the function returns a float
     if (functionReturn) {
         SgType *returnType = funcDec->get_orig_return_type()->findBaseType();
-        TypeStruct returnTypeDesc = TypeStruct(returnType->unparseToString());
+        TypeStruct returnTypeDesc = TypeStruct(unparse(returnType));
         returnNode->setType(returnTypeDesc);
         (new ImplicitCastDataFlowEdge(functionReturn, returnNode))->run();
     } else {
@@ -447,6 +473,12 @@ Node *ReturnEdge::getNode() {
     return privateNode;
 }
 
+// the return node and call locations are only made when printing
+void ReturnEdge::resetPrintState() {
+    returnLocations.clear();
+    privateNode = nullptr;
+}
+
 // if undefined, these variables will be stored in the edge itself
 void UndefinedFunctionEdge::setNodeVariables(Node *node) {
     node->functionID = funcID;
@@ -522,7 +554,7 @@ void FunctionCallEdge::run() {
             SgType *paramType = originalParam->get_type();
 
             // and build a type struct
-            TypeStruct parameterTypeDesc = TypeStruct(paramType->findBaseType()->unparseToString());
+            TypeStruct parameterTypeDesc = TypeStruct(unparse(paramType->findBaseType()));
             // if its an array type, we actually don't want the real pointer type
             // we want a void pointer (because this is what programl does)
             if (paramType->variantT() == V_SgArrayType || paramType->variantT() == V_SgPointerType) {
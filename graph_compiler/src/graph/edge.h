@@ -14,13 +14,18 @@ class Edge;
 
 class TypeStruct;
 
+// the control flow state is kept in the build state of the current graph
 class Edges {
   public:
-    static GraphGenerator *graphGenerator;
+    // the graph being built on this thread, see GraphGenerator::CurrentGraph
+    static thread_local GraphGenerator *graphGenerator;
     static Node *getPreviousControlFlowNode();
     static void updatePreviousControlFlowNode(Node *node);
     static void addPreviousControlFlowNodeChangeListener(Edge *edge);
 
+    // forget the control flow of a previous build of the graph
+    static void resetControlFlow();
+
     static void printSubControlFlowEdge(Node *source, Node *destination);
     static void printSubControlFlowEdge(Node *source, Node *destination, bool backEdge);
     static void printSubFunctionCallEdge(Node *source, Node *destination);
@@ -30,16 +35,24 @@ class Edges {
     static void printSubDataFlowEdge(Node *source, Node *destination, int order);
     static void printPragmaEdge(Node *source, Node *destination, int order);
 
-  private:
-    static Node *previousControlFlowNode;
-    static std::queue<Edge *> previousControlFlowNodeChangeListeners;
+    // a printed type node for an edge into the state node
+    // with --intern_types every edge of the same type in a BB shares one
+    static Node *getTypeNode(TypeStruct type, bool constant);
 };
 
 enum class EdgeVariant { DEFAULT, CONTROL_FLOW };
 
+// the name of a variant, e.g. CONTROL_FLOW
+std::string getVariantName(EdgeVariant variant);
+
 class Edge {
   public:
     Edge(Node *source, Node *destination);
+    virtual ~Edge() = default;
+
+    // edges are made in the arena of the graph being generated, which destroys them
+    static void *operator new(size_t size);
+    static void operator delete(void *memory) {}
 
     Node *source = nullptr;
     Node *destination = nullptr;
@@ -51,6 +64,9 @@ class Edge {
     virtual std::string toString() = 0;
     virtual void run() = 0;
     virtual void runDeferred() {}
+
+    // forget what running the edge stored, so the graph can be printed again
+    virtual void resetPrintState() {}
 };
 
 class ControlFlowEdge : public Edge {
@@ -171,6 +187,7 @@ class MergeStartEdge : public Edge {
     // As it doesn't know where to merge to yet
     // So it just saves where to merge from
     void run() override;
+    void resetPrintState() override { source1 = nullptr; }
     std::string toString() override { return "Merge Open Edge"; }
 };
 
@@ -195,6 +212,7 @@ class MergeEndEdge : public Edge {
     // we can get the current control flow node
     // and add an edge from source1 to it
     void runDeferred() override;
+    void resetPrintState() override { source2 = nullptr; }
     std::string toString() override { return "Merge Close Edge"; }
 };
 
@@ -252,6 +270,7 @@ class ReturnEdge : public Edge {
 
     virtual Node *getNode();
     void run() override;
+    void resetPrintState() override;
     std::string toString() override { return "Return Edge"; }
 
   protected:
@@ -282,6 +301,7 @@ class PreLoopEdge : public Edge {
 
     void run() override { Edges::addPreviousControlFlowNodeChangeListener(this); }
     void runDeferred() override { loopConditionStart = Edges::getPreviousControlFlowNode(); }
+    void resetPrintState() override { loopConditionStart = nullptr; }
     std::string toString() override { return "Pre Loop Edge"; }
 };
 
@@ -317,6 +337,7 @@ class FunctionStartEdge : public Edge {
 
     void run() override;
     void runDeferred() override;
+    void resetPrintState() override { callLocations.clear(); }
 
     std::string toString() override { return "Function Start Edge"; }
 };
@@ -4,8 +4,6 @@
 
 namespace {
 
-void output(const std::string &content) { std::cout << content << std::endl; }
-
 void controlFlowEdge(int id1, int id2, bool backEdge) {
     Balor::EdgePrinter printer(id1, id2);
     printer.attributes["color"] = "red";
@@ -35,9 +33,6 @@ namespace Balor {
 EdgePrinter::EdgePrinter(int id1, int id2) : id1(id1), id2(id2) { attributes["edgeOrder"] = "0"; }
 
 void EdgePrinter::print() {
-    std::string out = "node" + std::to_string(id1) + " -> node" + std::to_string(id2);
-    out += "[";
-
     // Maybe would be better never to add it?
     if (!Edges::graphGenerator->checkArg(ADD_EDGE_ORDER)) {
         attributes.erase("edgeOrder");
@@ -47,14 +42,7 @@ void EdgePrinter::print() {
         attributes["xlabel"] = attributes["edgeOrder"];
     }
 
-    for (std::pair<std::string, std::string> attribute : attributes) {
-        out += attribute.first;
-        out += "=\"";
-        out += attribute.second;
-        out += "\" ";
-    }
-    out += "]";
-    output(out);
+    Edges::graphGenerator->flatGraph.addEdge(id1, id2, attributes);
 }
 
 void Edges::printSubControlFlowEdge(Node *source, Node *destination) {
@@ -77,9 +65,7 @@ void Edges::printSubFunctionCallEdge(Node *source, Node *destination) {
 void Edges::printSubFunctionCallEdge(Node *source, Node *destination, int order) {
     // put nodes with function call edges from external at the top of their subgraph
     if (source->getVariant() == NodeVariant::EXTERNAL) {
-        output("subgraph cluster_" + destination->groupName + " {");
-        output("{rank=min; node" + std::to_string(destination->id) + "}");
-        output("}");
+        graphGenerator->flatGraph.addTopOfGroup(destination->groupName, destination->id);
     }
 
     bool externalSource = source->getVariant() == NodeVariant::EXTERNAL;
@@ -0,0 +1,224 @@
+#include "flatGraph.h"
+
+#include <algorithm>
+
+namespace {
+
+void pad(std::vector<Balor::FlatGraph::Column> &columns, size_t count) {
+    for (Balor::FlatGraph::Column &column : columns) {
+        column.values.resize(count, Balor::FlatGraph::NO_VALUE);
+    }
+}
+
+// counting sort of the edges by one of their ends
+void buildCSR(const std::vector<uint32_t> &ends, uint32_t numNodes, std::vector<uint32_t> &offsets,
+              std::vector<uint32_t> &edges) {
+    offsets.assign(numNodes + 1, 0);
+    for (uint32_t end : ends) {
+        offsets[end + 1]++;
+    }
+    for (uint32_t node = 0; node < numNodes; node++) {
+        offsets[node + 1] += offsets[node];
+    }
+
+    edges.resize(ends.size());
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    for (uint32_t edge = 0; edge < ends.size(); edge++) {
+        edges[next[ends[edge]]++] = edge;
+    }
+}
+
+} // namespace
+
+namespace Balor {
+
+// odr-used, e.g. by resize, so it needs a definition before C++17
+constexpr uint32_t FlatGraph::NO_VALUE;
+
+FlowType toFlowType(const std::string &flowType) {
+    if (flowType == "control") {
+        return FlowType::CONTROL;
+    }
+    if (flowType == "call") {
+        return FlowType::CALL;
+    }
+    if (flowType == "dataflow") {
+        return FlowType::DATA;
+    }
+    if (flowType == "address") {
+        return FlowType::ADDRESS;
+    }
+    if (flowType == "pragma") {
+        return FlowType::PRAGMA;
+    }
+    return FlowType::OTHER;
+}
+
+std::string getFlowTypeName(FlowType flowType) {
+    switch (flowType) {
+    case FlowType::CONTROL:
+        return "control";
+    case FlowType::CALL:
+        return "call";
+    case FlowType::DATA:
+        return "dataflow";
+    case FlowType::ADDRESS:
+        return "address";
+    case FlowType::PRAGMA:
+        return "pragma";
+    default:
+        return "other";
+    }
+}
+
+uint32_t StringTable::intern(const std::string &string) {
+    auto found = ids.find(string);
+    if (found != ids.end()) {
+        return found->second;
+    }
+    uint32_t id = strings.size();
+    strings.push_back(string);
+    ids[string] = id;
+    return id;
+}
+
+void StringTable::clear() {
+    strings.clear();
+    ids.clear();
+}
+
+void FlatGraph::clear() {
+    strings.clear();
+    items.clear();
+    topsOfGroups.clear();
+    graphAttributes.clear();
+
+    nodePrintIDs.clear();
+    nodeBBIDs.clear();
+    nodeLoopIDs.clear();
+    nodeColors.clear();
+    nodeImplicit.clear();
+    nodeColumns.clear();
+    nodeColumnIndices.clear();
+
+    edgeSources.clear();
+    edgeDestinations.clear();
+    edgeFlowTypes.clear();
+    edgeColumns.clear();
+    edgeColumnIndices.clear();
+
+    outOffsets.clear();
+    outEdges.clear();
+    inOffsets.clear();
+    inEdges.clear();
+
+    printIDToIndex.clear();
+}
+
+uint32_t FlatGraph::getNode(int printID) {
+    auto found = printIDToIndex.find(printID);
+    if (found != printIDToIndex.end()) {
+        return found->second;
+    }
+
+    // an edge can name a node that isn't written, DOT draws it anyway
+    uint32_t node = nodePrintIDs.size();
+    printIDToIndex[printID] = node;
+    nodePrintIDs.push_back(printID);
+    nodeBBIDs.push_back(0);
+    nodeLoopIDs.push_back(0);
+    nodeColors.push_back(NO_VALUE);
+    nodeImplicit.push_back(true);
+    return node;
+}
+
+void FlatGraph::setAttributes(std::vector<Column> &columns, std::unordered_map<uint32_t, uint32_t> &columnIndices,
+                              uint32_t row, const std::map<std::string, std::string> &attributes) {
+    for (const std::pair<const std::string, std::string> &attribute : attributes) {
+        uint32_t name = strings.intern(attribute.first);
+
+        auto found = columnIndices.find(name);
+        if (found == columnIndices.end()) {
+            found = columnIndices.emplace(name, columns.size()).first;
+            columns.push_back(Column{name, {}});
+        }
+
+        // columns are only padded up to the rows that have them until finish
+        std::vector<uint32_t> &values = columns[found->second].values;
+        if (values.size() <= row) {
+            values.resize(row + 1, NO_VALUE);
+        }
+        values[row] = strings.intern(attribute.second);
+    }
+}
+
+uint32_t FlatGraph::addNode(int printID, int bbID, int loopID, const std::string &color,
+                            const std::map<std::string, std::string> &attributes) {
+    uint32_t node;
+    auto found = printIDToIndex.find(printID);
+    if (found != printIDToIndex.end() && nodeImplicit[found->second]) {
+        // an edge got to it first
+        node = found->second;
+    } else {
+        node = nodePrintIDs.size();
+        printIDToIndex[printID] = node;
+        nodePrintIDs.push_back(printID);
+        nodeBBIDs.push_back(0);
+        nodeLoopIDs.push_back(0);
+        nodeColors.push_back(NO_VALUE);
+        nodeImplicit.push_back(true);
+    }
+
+    nodeBBIDs[node] = bbID;
+    nodeLoopIDs[node] = loopID;
+    nodeColors[node] = strings.intern(color);
+    nodeImplicit[node] = false;
+    setAttributes(nodeColumns, nodeColumnIndices, node, attributes);
+
+    items.push_back(Item{ItemKind::NODE, node});
+    return node;
+}
+
+uint32_t FlatGraph::addEdge(int printID1, int printID2, const std::map<std::string, std::string> &attributes) {
+    uint32_t edge = edgeSources.size();
+    edgeSources.push_back(getNode(printID1));
+    edgeDestinations.push_back(getNode(printID2));
+
+    auto flowType = attributes.find("flowType");
+    edgeFlowTypes.push_back(flowType == attributes.end() ? FlowType::OTHER : toFlowType(flowType->second));
+
+    setAttributes(edgeColumns, edgeColumnIndices, edge, attributes);
+
+    items.push_back(Item{ItemKind::EDGE, edge});
+    return edge;
+}
+
+void FlatGraph::addTopOfGroup(const std::string &groupName, int printID) {
+    items.push_back(Item{ItemKind::TOP_OF_GROUP, static_cast<uint32_t>(topsOfGroups.size())});
+    topsOfGroups.push_back(TopOfGroup{strings.intern(groupName), getNode(printID)});
+}
+
+void FlatGraph::setGraphAttribute(const std::string &name, const std::string &value) {
+    graphAttributes[name] = value;
+}
+
+void FlatGraph::finish() {
+    pad(nodeColumns, getNumNodes());
+    pad(edgeColumns, getNumEdges());
+
+    buildCSR(edgeSources, getNumNodes(), outOffsets, outEdges);
+    buildCSR(edgeDestinations, getNumNodes(), inOffsets, inEdges);
+}
+
+std::vector<const FlatGraph::Column *> FlatGraph::sortedByName(const std::vector<Column> &columns) const {
+    std::vector<const Column *> sorted;
+    for (const Column &column : columns) {
+        sorted.push_back(&column);
+    }
+    std::sort(sorted.begin(), sorted.end(), [this](const Column *a, const Column *b) {
+        return strings.get(a->name) < strings.get(b->name);
+    });
+    return sorted;
+}
+
+} // namespace Balor
@@ -0,0 +1,141 @@
+#ifndef BALOR_FLAT_GRAPH_H
+#define BALOR_FLAT_GRAPH_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Balor {
+
+// the flowType attribute of an edge
+enum class FlowType : uint8_t { CONTROL, CALL, DATA, ADDRESS, PRAGMA, OTHER };
+
+FlowType toFlowType(const std::string &flowType);
+// the flowType attribute of edges of the type, "other" for edges without a known one
+std::string getFlowTypeName(FlowType flowType);
+
+// Strings stored once and referred to by index
+class StringTable {
+  public:
+    uint32_t intern(const std::string &string);
+    const std::string &get(uint32_t id) const { return strings[id]; }
+    size_t size() const { return strings.size(); }
+
+    void clear();
+
+  private:
+    std::vector<std::string> strings;
+    std::unordered_map<std::string, uint32_t> ids;
+};
+
+// The printed graph, as flat arrays rather than nodes and edges pointing at each other
+//
+// nodes are numbered 0..n in the order they were first seen, their fields are kept
+// struct of arrays, and every attribute is a column of interned values over all nodes
+// edges are COO arrays of node indices tagged with their flow type, and have
+// attribute columns the same way, CSR adjacency is built by finish()
+//
+// nodes are written with the ID given by setNodeID, which the DOT output uses for names
+class FlatGraph {
+  public:
+    static constexpr uint32_t NO_VALUE = UINT32_MAX;
+
+    // one attribute of every node or edge, NO_VALUE where one doesn't have it
+    struct Column {
+        uint32_t name;
+        std::vector<uint32_t> values;
+    };
+
+    // the order things were added in, the DOT output follows it
+    enum class ItemKind : uint8_t { NODE, EDGE, TOP_OF_GROUP };
+    struct Item {
+        ItemKind kind;
+        uint32_t index;
+    };
+
+    // a node drawn at the top of its function's subgraph
+    struct TopOfGroup {
+        uint32_t groupName;
+        uint32_t node;
+    };
+
+    void clear();
+
+    uint32_t addNode(int printID, int bbID, int loopID, const std::string &color,
+                     const std::map<std::string, std::string> &attributes);
+    uint32_t addEdge(int printID1, int printID2, const std::map<std::string, std::string> &attributes);
+    void addTopOfGroup(const std::string &groupName, int printID);
+
+    // an attribute of the whole graph, e.g. how it was made
+    void setGraphAttribute(const std::string &name, const std::string &value);
+    const std::map<std::string, std::string> &getGraphAttributes() const { return graphAttributes; }
+
+    // pad the columns and build the adjacency, after the last node and edge
+    void finish();
+
+    uint32_t getNumNodes() const { return nodePrintIDs.size(); }
+    uint32_t getNumEdges() const { return edgeSources.size(); }
+
+    const StringTable &getStrings() const { return strings; }
+    const std::vector<Item> &getItems() const { return items; }
+    const std::vector<TopOfGroup> &getTopsOfGroups() const { return topsOfGroups; }
+
+    const std::vector<int> &getNodePrintIDs() const { return nodePrintIDs; }
+    const std::vector<int> &getNodeBBIDs() const { return nodeBBIDs; }
+    const std::vector<int> &getNodeLoopIDs() const { return nodeLoopIDs; }
+    const std::vector<uint32_t> &getNodeColors() const { return nodeColors; }
+    // a node only an edge referred to, which was never written itself
+    bool isImplicit(uint32_t node) const { return nodeImplicit[node]; }
+    const std::vector<Column> &getNodeColumns() const { return nodeColumns; }
+
+    const std::vector<uint32_t> &getEdgeSources() const { return edgeSources; }
+    const std::vector<uint32_t> &getEdgeDestinations() const { return edgeDestinations; }
+    const std::vector<FlowType> &getEdgeFlowTypes() const { return edgeFlowTypes; }
+    const std::vector<Column> &getEdgeColumns() const { return edgeColumns; }
+
+    // the edges out of node n are outEdges[outOffsets[n]] up to outEdges[outOffsets[n + 1]]
+    const std::vector<uint32_t> &getOutOffsets() const { return outOffsets; }
+    const std::vector<uint32_t> &getOutEdges() const { return outEdges; }
+    const std::vector<uint32_t> &getInOffsets() const { return inOffsets; }
+    const std::vector<uint32_t> &getInEdges() const { return inEdges; }
+
+    // the columns in order of their names, the order attributes are written in
+    std::vector<const Column *> sortedByName(const std::vector<Column> &columns) const;
+
+  private:
+    StringTable strings;
+    std::vector<Item> items;
+    std::vector<TopOfGroup> topsOfGroups;
+    std::map<std::string, std::string> graphAttributes;
+
+    std::vector<int> nodePrintIDs;
+    std::vector<int> nodeBBIDs;
+    std::vector<int> nodeLoopIDs;
+    std::vector<uint32_t> nodeColors;
+    std::vector<bool> nodeImplicit;
+    std::vector<Column> nodeColumns;
+    std::unordered_map<uint32_t, uint32_t> nodeColumnIndices;
+
+    std::vector<uint32_t> edgeSources;
+    std::vector<uint32_t> edgeDestinations;
+    std::vector<FlowType> edgeFlowTypes;
+    std::vector<Column> edgeColumns;
+    std::unordered_map<uint32_t, uint32_t> edgeColumnIndices;
+
+    std::vector<uint32_t> outOffsets;
+    std::vector<uint32_t> outEdges;
+    std::vector<uint32_t> inOffsets;
+    std::vector<uint32_t> inEdges;
+
+    std::unordered_map<int, uint32_t> printIDToIndex;
+
+    uint32_t getNode(int printID);
+    void setAttributes(std::vector<Column> &columns, std::unordered_map<uint32_t, uint32_t> &columnIndices,
+                       uint32_t row, const std::map<std::string, std::string> &attributes);
+};
+
+} // namespace Balor
+
+#endif
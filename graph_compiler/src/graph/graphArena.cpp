@@ -0,0 +1,58 @@
+#include "graphArena.h"
+
+namespace Balor {
+
+GraphArena::GraphArena(size_t blockSize) : blockSize(blockSize) {}
+
+void *GraphArena::allocate(size_t size) {
+    const size_t alignment = alignof(std::max_align_t);
+    size = (size + alignment - 1) / alignment * alignment;
+
+    // try the current block, then any blocks kept from before a rewind
+    while (currentBlock < blocks.size()) {
+        Block &block = blocks[currentBlock];
+        if (offset + size <= block.size) {
+            void *memory = block.memory.get() + offset;
+            offset += size;
+            return memory;
+        }
+        currentBlock++;
+        offset = 0;
+    }
+
+    // new char[] is aligned for any type that fits
+    size_t newBlockSize = size > blockSize ? size : blockSize;
+    blocks.push_back(Block{std::unique_ptr<char[]>(new char[newBlockSize]), newBlockSize});
+
+    currentBlock = blocks.size() - 1;
+    offset = size;
+    return blocks.back().memory.get();
+}
+
+GraphArena::Mark GraphArena::mark() const {
+    Mark mark;
+    mark.block = currentBlock;
+    mark.offset = offset;
+    return mark;
+}
+
+void GraphArena::rewind(Mark mark) {
+    currentBlock = mark.block;
+    offset = mark.offset;
+}
+
+void GraphArena::release() {
+    blocks.clear();
+    currentBlock = 0;
+    offset = 0;
+}
+
+size_t GraphArena::getBytesReserved() const {
+    size_t bytes = 0;
+    for (const Block &block : blocks) {
+        bytes += block.size;
+    }
+    return bytes;
+}
+
+} // namespace Balor
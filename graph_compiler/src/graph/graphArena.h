@@ -0,0 +1,51 @@
+#ifndef BALOR_GRAPH_ARENA_H
+#define BALOR_GRAPH_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Balor {
+
+// Bump allocator for the nodes and edges of a graph
+// memory is taken from large blocks, and is given back all at once by rewinding,
+// the blocks are kept so the next graph made in the arena doesn't allocate again
+//
+// the arena doesn't run destructors, whoever makes objects in it destroys them before rewinding
+class GraphArena {
+  public:
+    GraphArena(size_t blockSize = 1 << 16);
+    GraphArena(const GraphArena &) = delete;
+    GraphArena &operator=(const GraphArena &) = delete;
+
+    // aligned for any type
+    void *allocate(size_t size);
+
+    // a point in the arena to rewind to, everything allocated after it is reused
+    struct Mark {
+        size_t block = 0;
+        size_t offset = 0;
+    };
+    Mark mark() const;
+    void rewind(Mark mark);
+    void clear() { rewind(Mark()); }
+    // give the blocks back as well, nothing made in the arena can be left
+    void release();
+
+    size_t getBytesReserved() const;
+
+  private:
+    struct Block {
+        std::unique_ptr<char[]> memory;
+        size_t size;
+    };
+
+    size_t blockSize;
+    std::vector<Block> blocks;
+    size_t currentBlock = 0;
+    size_t offset = 0;
+};
+
+} // namespace Balor
+
+#endif
@@ -0,0 +1,176 @@
+#include "graphCompaction.h"
+
+#include <map>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// the index of the column with this name, -1 if no node or edge has the attribute
+int findColumn(const Balor::FlatGraph &graph, const std::vector<Balor::FlatGraph::Column> &columns,
+               const std::string &name) {
+    for (size_t column = 0; column < columns.size(); column++) {
+        if (graph.getStrings().get(columns[column].name) == name) {
+            return column;
+        }
+    }
+    return -1;
+}
+
+std::map<std::string, std::string> getAttributes(const Balor::FlatGraph &graph,
+                                                 const std::vector<Balor::FlatGraph::Column> &columns, uint32_t row) {
+    std::map<std::string, std::string> attributes;
+    for (const Balor::FlatGraph::Column &column : columns) {
+        if (column.values[row] != Balor::FlatGraph::NO_VALUE) {
+            attributes[graph.getStrings().get(column.name)] = graph.getStrings().get(column.values[row]);
+        }
+    }
+    return attributes;
+}
+
+} // namespace
+
+namespace Balor {
+
+CompactionStats compactGraph(FlatGraph &graph) {
+    const StringTable &strings = graph.getStrings();
+    const std::vector<FlatGraph::Column> &nodeColumns = graph.getNodeColumns();
+    const std::vector<uint32_t> &sources = graph.getEdgeSources();
+    const std::vector<uint32_t> &destinations = graph.getEdgeDestinations();
+    const std::vector<FlowType> &flowTypes = graph.getEdgeFlowTypes();
+    const std::vector<uint32_t> &outOffsets = graph.getOutOffsets();
+    const std::vector<uint32_t> &inOffsets = graph.getInOffsets();
+    uint32_t numNodes = graph.getNumNodes();
+    uint32_t numEdges = graph.getNumEdges();
+
+    CompactionStats stats;
+
+    // the node each constant is merged into, every other node is itself
+    std::vector<uint32_t> mergedInto(numNodes);
+    std::iota(mergedInto.begin(), mergedInto.end(), 0);
+
+    int keyTextColumn = findColumn(graph, nodeColumns, "keyText");
+    int labelColumn = findColumn(graph, nodeColumns, "label");
+    int bbIDColumn = findColumn(graph, nodeColumns, "bbID");
+    if (keyTextColumn >= 0) {
+        // the group attribute is the function, so constants are only merged within one
+        std::map<std::pair<std::vector<uint32_t>, std::string>, uint32_t> constants;
+        for (uint32_t node = 0; node < numNodes; node++) {
+            uint32_t keyText = nodeColumns[keyTextColumn].values[node];
+            if (graph.isImplicit(node) || keyText == FlatGraph::NO_VALUE || strings.get(keyText) != "constantValue") {
+                continue;
+            }
+
+            // the BB of a constant doesn't matter, the merged one keeps the BB of the first
+            std::vector<uint32_t> attributes = {graph.getNodeColors()[node]};
+            for (int column = 0; column < int(nodeColumns.size()); column++) {
+                if (column != bbIDColumn && column != labelColumn) {
+                    attributes.push_back(nodeColumns[column].values[node]);
+                }
+            }
+
+            // the value is the first line of the label, the rest is made from the other attributes
+            std::string value;
+            if (labelColumn >= 0 && nodeColumns[labelColumn].values[node] != FlatGraph::NO_VALUE) {
+                const std::string &label = strings.get(nodeColumns[labelColumn].values[node]);
+                value = label.substr(0, label.find('\n'));
+            }
+
+            auto constant = constants.emplace(std::make_pair(attributes, value), node).first;
+            if (constant->second != node) {
+                mergedInto[node] = constant->second;
+                stats.constantsMerged++;
+            }
+        }
+    }
+
+    // nodes with nothing but one control flow edge in and one out
+    std::vector<bool> collapsible(numNodes, false);
+    for (uint32_t node = 0; node < numNodes; node++) {
+        if (graph.isImplicit(node) || inOffsets[node + 1] - inOffsets[node] != 1 ||
+            outOffsets[node + 1] - outOffsets[node] != 1) {
+            continue;
+        }
+        uint32_t inEdge = graph.getInEdges()[inOffsets[node]];
+        uint32_t outEdge = graph.getOutEdges()[outOffsets[node]];
+        if (flowTypes[inEdge] != FlowType::CONTROL || flowTypes[outEdge] != FlowType::CONTROL || inEdge == outEdge) {
+            continue;
+        }
+        collapsible[node] = true;
+        stats.controlNodesCollapsed++;
+    }
+
+    // an edge into a chain of collapsed nodes goes to the end of the chain instead,
+    // as the last edge of the chain, so a back edge out of the chain is still a back edge
+    std::vector<bool> keepEdge(numEdges, false);
+    std::vector<uint32_t> edgeSources(numEdges);
+    std::vector<uint32_t> edgeDestinations(numEdges);
+    std::vector<uint32_t> edgeAttributesFrom(numEdges);
+    std::vector<bool> hasEdge(numNodes, false);
+    for (uint32_t edge = 0; edge < numEdges; edge++) {
+        uint32_t source = mergedInto[sources[edge]];
+        // edges out of a collapsed node are part of the edge into it
+        if (collapsible[source]) {
+            continue;
+        }
+
+        uint32_t last = edge;
+        uint32_t destination = mergedInto[destinations[edge]];
+        for (uint32_t steps = 0; collapsible[destination] && steps < numNodes; steps++) {
+            last = graph.getOutEdges()[outOffsets[destination]];
+            destination = mergedInto[destinations[last]];
+        }
+        if (collapsible[destination]) {
+            continue;
+        }
+
+        keepEdge[edge] = true;
+        edgeSources[edge] = source;
+        edgeDestinations[edge] = destination;
+        edgeAttributesFrom[edge] = last;
+        hasEdge[source] = true;
+        hasEdge[destination] = true;
+    }
+
+    std::vector<bool> keepNode(numNodes);
+    for (uint32_t node = 0; node < numNodes; node++) {
+        keepNode[node] = mergedInto[node] == node && !collapsible[node] && hasEdge[node];
+    }
+
+    // add what is kept again, in the order it was first added
+    const std::vector<int> &printIDs = graph.getNodePrintIDs();
+    FlatGraph compacted;
+    for (const FlatGraph::Item &item : graph.getItems()) {
+        if (item.kind == FlatGraph::ItemKind::NODE) {
+            if (keepNode[item.index]) {
+                compacted.addNode(printIDs[item.index], graph.getNodeBBIDs()[item.index],
+                                  graph.getNodeLoopIDs()[item.index], strings.get(graph.getNodeColors()[item.index]),
+                                  getAttributes(graph, nodeColumns, item.index));
+            }
+        } else if (item.kind == FlatGraph::ItemKind::EDGE) {
+            if (keepEdge[item.index]) {
+                compacted.addEdge(printIDs[edgeSources[item.index]], printIDs[edgeDestinations[item.index]],
+                                  getAttributes(graph, graph.getEdgeColumns(), edgeAttributesFrom[item.index]));
+            }
+        } else {
+            const FlatGraph::TopOfGroup &top = graph.getTopsOfGroups()[item.index];
+            if (keepNode[top.node]) {
+                compacted.addTopOfGroup(strings.get(top.groupName), printIDs[top.node]);
+            }
+        }
+    }
+    for (const std::pair<const std::string, std::string> &attribute : graph.getGraphAttributes()) {
+        compacted.setGraphAttribute(attribute.first, attribute.second);
+    }
+    compacted.finish();
+
+    stats.nodesRemoved = numNodes - compacted.getNumNodes();
+    stats.edgesRemoved = numEdges - compacted.getNumEdges();
+
+    graph = std::move(compacted);
+    return stats;
+}
+
+} // namespace Balor
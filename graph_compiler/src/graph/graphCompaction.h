@@ -0,0 +1,29 @@
+#ifndef BALOR_GRAPH_COMPACTION_H
+#define BALOR_GRAPH_COMPACTION_H
+
+#include "flatGraph.h"
+
+#include <cstdint>
+
+namespace Balor {
+
+// What compacting a graph removed
+struct CompactionStats {
+    uint32_t constantsMerged = 0;
+    uint32_t controlNodesCollapsed = 0;
+    uint32_t nodesRemoved = 0;
+    uint32_t edgesRemoved = 0;
+};
+
+// Make a printed graph smaller without changing what it describes:
+// - constants with the same value and attributes in the same function become one node
+// - a node that only has control flow, one edge in and one edge out, e.g. an unconditional branch,
+//   is skipped by an edge from its predecessor straight to its successor
+// - nodes left without any edges are dropped
+//
+// nodes keep their print IDs and everything is added in the same order, so the DOT output only loses lines
+CompactionStats compactGraph(FlatGraph &graph);
+
+} // namespace Balor
+
+#endif
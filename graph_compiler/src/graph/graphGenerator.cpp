@@ -1,4 +1,7 @@
 #include "graphGenerator.h"
+#include "../commandLine.h"
+#include "../designLimits.h"
+#include "../profile.h"
 #include "../utility.h"
 #include "args.h"
 #include "nodeUtils.h"
@@ -9,7 +12,15 @@
 
 namespace Balor {
 
-GraphGenerator::GraphGenerator(Sawyer::CommandLine::ParserResult parserResult) {
+GraphGenerator::GraphGenerator(Sawyer::CommandLine::ParserResult parserResult, GraphArena *arena,
+                               const GraphConfig *config)
+    : arena(arena) {
+    if (!this->arena) {
+        ownArena = std::make_unique<GraphArena>();
+        this->arena = ownArena.get();
+    }
+    arenaStart = this->arena->mark();
+
     for (auto arg : ARGS) {
         std::string argName = arg.first;
         if (parserResult.have(argName)) {
@@ -19,40 +30,157 @@ GraphGenerator::GraphGenerator(Sawyer::CommandLine::ParserResult parserResult) {
         }
     }
 
+    maxNodes = Balor::CommandLine::getMaxNodes(parserResult);
+
     datasetIndex = parserResult.parsed("datasetIndex").back().asString();
     graphType = parserResult.parsed("graphType").back().asString();
 
+    if (config) {
+        for (const std::string &arg : config->args) {
+            argMap[arg] = true;
+        }
+        graphType = config->graphType;
+    }
+
+    for (const std::string &format : Balor::CommandLine::getOutputFormats(parserResult)) {
+        graphWriters.push_back(makeGraphWriter(format));
+    }
+
     variableMapper = std::make_unique<VariableMapper>(this);
     pragmaParser = std::make_unique<PragmaParser>(this);
-    derefTracker = std::make_unique<DerefTracker>();
+    derefTracker = std::make_unique<DerefTracker>(variableMapper.get());
     astParser = std::make_unique<AstParser>(this);
 }
 
+GraphGenerator::~GraphGenerator() {
+    destroyAllocated(0, 0);
+    arena->rewind(arenaStart);
+}
+
+void GraphGenerator::destroyAllocated(size_t numNodes, size_t numEdges) {
+    // the arena only gives the memory back, the destructors are run here, newest first
+    while (allocatedEdges.size() > numEdges) {
+        allocatedEdges.back()->~Edge();
+        allocatedEdges.pop_back();
+    }
+    while (allocatedNodes.size() > numNodes) {
+        allocatedNodes.back()->~Node();
+        allocatedNodes.pop_back();
+    }
+}
+
 bool GraphGenerator::checkArg(const std::string &arg) {
     assert(argMap.count(arg));
     return argMap[arg];
 }
 
-// Print a dot file description of the graph to the terminal
-void GraphGenerator::printGraph() {
-    // make a directed graph
-    std::cout << "digraph {" << std::endl;
-    std::cout << "newrank=\"true\";" << std::endl;
+// Print a description of the graph to the terminal, in the first output format
+void GraphGenerator::printGraph() { printGraph(*graphWriters.front()); }
+
+void GraphGenerator::printGraph(GraphWriter &graphWriter) {
+    BasicBlockGraph *cfg = checkArg(ADD_CFG) ? &basicBlockGraph : nullptr;
+    LoopTree *loops = checkArg(ADD_LOOP_TREE) ? &loopTree : nullptr;
+
+    Profile::Phase phase("write:" + graphWriter.getExtension());
+    graphWriter.write(flatGraph, cfg, loops);
+}
+
+void GraphGenerator::resolveGraph() {
+    clearReductions();
+    resolveFlatGraph();
+
+    // every switch in order loses a little more, the first that makes the graph fit is where it stops
+    for (const std::string &reduction : GRAPH_REDUCTIONS) {
+        if (!maxNodes || flatGraph.getNumNodes() <= maxNodes) {
+            break;
+        }
+        if (argMap[reduction]) {
+            continue;
+        }
+        argMap[reduction] = true;
+        appliedReductions.push_back(reduction);
+        resolveFlatGraph();
+    }
+
+    if (maxNodes) {
+        flatGraph.setGraphAttribute("maxNodes", std::to_string(maxNodes));
+        flatGraph.setGraphAttribute("reductions", boost::algorithm::join(appliedReductions, ","));
+    }
+
+    if (checkArg(ADD_CFG)) {
+        basicBlockGraph.build(flatGraph);
+    }
+    if (checkArg(ADD_LOOP_TREE)) {
+        buildLoopTree();
+    }
+
+    if (Profile::isEnabled()) {
+        // the nodes and edges of the graph that is kept, not of each resolve made to fit the budget
+        // edges by the flow they are written as, their variants only tell deferred edges apart
+        for (Node *node : nodes) {
+            Profile::count("nodes:" + getVariantName(node->getVariant()));
+        }
+        for (FlowType flowType : flatGraph.getEdgeFlowTypes()) {
+            Profile::count("edges:" + getFlowTypeName(flowType));
+        }
+    }
+}
+
+void GraphGenerator::buildLoopTree() {
+    loopTree.clear();
+    for (LoopNode *loopNode : loopNodes) {
+        LoopTree::Loop loop;
+        loop.functionID = loopNode->functionID;
+        loop.tripcount = loopNode->tripcount.first;
+        loop.unrollFactor = loopNode->unrollFactor.first;
+        loop.pipelined = loopNode->pipelined;
+        loop.pipelinedType = int(loopNode->pipelinedType);
+        loopTree.addLoop(loopNode->loop, loopNode->parentLoop, loop);
+    }
+    loopTree.build(flatGraph);
+}
+
+void GraphGenerator::clearReductions() {
+    for (const std::string &reduction : appliedReductions) {
+        argMap[reduction] = false;
+    }
+    appliedReductions.clear();
+}
+
+void GraphGenerator::resolveFlatGraph() {
+    restoreBuiltGraph();
+
+    flatGraph.clear();
+    // the type nodes of a previous resolve were destroyed with it
+    buildState.typeNodes.clear();
+    buildState.printedNodes.clear();
 
     std::vector<Node *> nodesFrozen = nodes;
 
     // node ID starts at 0
     Nodes::resetNodeID();
-    // for each node
-    for (Node *node : nodesFrozen) {
-        node->print();
+    {
+        Profile::Phase phase("printNodes");
+        // for each node
+        for (Node *node : nodesFrozen) {
+            Limits::check();
+            node->print();
+        }
     }
-    std::vector<Edge *> edgesFrozen = edges;
-    for (Edge *edge : edgesFrozen) {
-        edge->run();
+    {
+        Profile::Phase phase("runEdges");
+        std::vector<Edge *> edgesFrozen = edges;
+        for (Edge *edge : edgesFrozen) {
+            Limits::check();
+            edge->run();
+        }
+    }
+
+    flatGraph.finish();
+
+    if (checkArg(COMPACT)) {
+        compactionStats = compactGraph(flatGraph);
     }
-    // close the directed graph
-    std::cout << "}" << std::endl;
 }
 
 std::string GraphGenerator::getGroupName() {
@@ -92,6 +220,32 @@ int GraphGenerator::getFunctionID() {
 }
 void GraphGenerator::enterNewFunction() { functionID++; }
 
+int GraphGenerator::getLoopID() {
+    if (stateNode) {
+        return stateNode->loopID;
+    }
+    if (loopStack.empty()) {
+        return 0;
+    }
+    return loopStack.back();
+}
+
+void GraphGenerator::enterLoop() {
+    numLoops++;
+    loopStack.push_back(numLoops);
+}
+
+void GraphGenerator::enterLoopBody() {
+    int parentLoop = loopStack.size() > 1 ? loopStack[loopStack.size() - 2] : 0;
+
+    // the loop node isn't written, so it doesn't count as something in the BB
+    bool wasEmpty = bbEmpty;
+    loopNodes.push_back(new LoopNode(loopStack.back(), parentLoop));
+    bbEmpty = wasEmpty;
+}
+
+void GraphGenerator::exitLoop() { loopStack.pop_back(); }
+
 SgFunctionDeclaration *GraphGenerator::getFuncDec(){
     if(stateNode){
         return stateNode->funcDec;
@@ -118,6 +272,16 @@ void GraphGenerator::setFuncInlined(SgFunctionDeclaration *funcDec, bool inlined
     isDecInlined[funcDec] = inlined;
 }
 
+void GraphGenerator::resetFuncsInlined() {
+    // the first time through, before any inline pragmas, holds the defaults
+    if (!inlinedDefaultsSaved) {
+        isDecInlinedDefaults = isDecInlined;
+        inlinedDefaultsSaved = true;
+    } else {
+        isDecInlined = isDecInlinedDefaults;
+    }
+}
+
 bool GraphGenerator::getFuncInlined(SgFunctionDeclaration *funcDec){
     assert(isDecInlined.count(funcDec));
     return isDecInlined[funcDec];
@@ -132,10 +296,159 @@ int GraphGenerator::getCallSiteNums(SgFunctionDeclaration *funcDec){
     return funcDecsToCallSiteNums[funcDec];
 }
 
+GraphGenerator::CurrentGraph::CurrentGraph(GraphGenerator *graphGenerator)
+    : previousNodesGraph(Nodes::graphGenerator), previousEdgesGraph(Edges::graphGenerator),
+      previousUseDefIndices(UseDefIndices::current) {
+    Nodes::graphGenerator = graphGenerator;
+    Edges::graphGenerator = graphGenerator;
+    UseDefIndices::current = &graphGenerator->useDefIndices;
+}
+
+GraphGenerator::CurrentGraph::~CurrentGraph() {
+    Nodes::graphGenerator = previousNodesGraph;
+    Edges::graphGenerator = previousEdgesGraph;
+    UseDefIndices::current = previousUseDefIndices;
+}
+
 void GraphGenerator::generateGraph(SgFunctionDefinition *topLevelFuncDef) {
-    Edges::graphGenerator = this;
-    Nodes::graphGenerator = this;
-    astParser->parseAst(topLevelFuncDef);
+    CurrentGraph currentGraph(this);
+    Edges::resetControlFlow();
+    {
+        Profile::Phase phase("parseAst");
+        astParser->parseAst(topLevelFuncDef);
+    }
+    saveBuiltGraph();
+    resolveGraph();
+}
+
+void GraphGenerator::saveBuiltGraph() {
+    builtGraph = std::make_unique<BuiltGraph>();
+
+    builtGraph->nodes = nodes;
+    builtGraph->edges = edges;
+    builtGraph->numNodes = allocatedNodes.size();
+    builtGraph->numEdges = allocatedEdges.size();
+    builtGraph->arenaMark = arena->mark();
+    builtGraph->numPragmaEvents = pragmaParser->getNumEvents();
+
+    builtGraph->groupName = groupName;
+    builtGraph->bbID = bbID;
+    builtGraph->functionID = functionID;
+    builtGraph->bbEmpty = bbEmpty;
+    builtGraph->funcDec = funcDec;
+    builtGraph->stateNode = stateNode;
+
+    builtGraph->funcDecsToCallNums = funcDecsToCallNums;
+    builtGraph->funcDecsToCallSiteNums = funcDecsToCallSiteNums;
+
+    builtGraph->variableToWriteNode = variableMapper->variableToWriteNode;
+    builtGraph->variableToReadNode = variableMapper->variableToReadNode;
+    builtGraph->nonReadVariables.insert(variableMapper->nonReadVariables.begin(),
+                                        variableMapper->nonReadVariables.end());
+    builtGraph->underlyingVariableMap = variableMapper->underlyingVariableMap;
+
+    for (Node *node : nodes) {
+        node->saveBuiltState();
+    }
+}
+
+void GraphGenerator::restoreBuiltGraph() {
+    // a graph that was never generated has nothing to go back to
+    if (!builtGraph) {
+        return;
+    }
+
+    // anything past the built graph was made by a previous print
+    destroyAllocated(builtGraph->numNodes, builtGraph->numEdges);
+    arena->rewind(builtGraph->arenaMark);
+    nodes = builtGraph->nodes;
+    edges = builtGraph->edges;
+    pragmaParser->truncateEvents(builtGraph->numPragmaEvents);
+
+    groupName = builtGraph->groupName;
+    bbID = builtGraph->bbID;
+    functionID = builtGraph->functionID;
+    bbEmpty = builtGraph->bbEmpty;
+    funcDec = builtGraph->funcDec;
+    stateNode = builtGraph->stateNode;
+
+    funcDecsToCallNums = builtGraph->funcDecsToCallNums;
+    funcDecsToCallSiteNums = builtGraph->funcDecsToCallSiteNums;
+
+    variableMapper->variableToWriteNode = builtGraph->variableToWriteNode;
+    variableMapper->variableToReadNode = builtGraph->variableToReadNode;
+    variableMapper->nonReadVariables.clear();
+    variableMapper->nonReadVariables.insert(builtGraph->nonReadVariables.begin(), builtGraph->nonReadVariables.end());
+    variableMapper->underlyingVariableMap = builtGraph->underlyingVariableMap;
+
+    for (Node *node : nodes) {
+        node->restoreBuiltState();
+    }
+    for (Edge *edge : edges) {
+        edge->resetPrintState();
+    }
+
+    Edges::resetControlFlow();
+}
+
+bool GraphGenerator::reannotatePragmas() {
+    // absorb_pragmas may only have been turned on to fit the last design in the budget
+    clearReductions();
+
+    // pragma nodes are part of the structure otherwise
+    if (!checkArg(ABSORB_PRAGMAS) || !builtGraph) {
+        return false;
+    }
+
+    CurrentGraph currentGraph(this);
+    restoreBuiltGraph();
+
+    pragmaParser->reset();
+    variableMapper->resourceTypeMap.clear();
+    variableMapper->arrayPartitionMap.clear();
+    funcDecsToCallNums.clear();
+    funcDecsToCallSiteNums.clear();
+
+    // the events are replayed in the order they were logged when building,
+    // and each node takes the pragma state from when it was made
+    const std::vector<PragmaEvent> &events = pragmaParser->getEvents();
+    int eventIndex = 0;
+
+    for (size_t i = 0; i < builtGraph->numNodes; i++) {
+        Node *node = allocatedNodes[i];
+
+        for (; eventIndex < node->pragmaEvent; eventIndex++) {
+            if (!pragmaParser->replayEvent(events[eventIndex])) {
+                return false;
+            }
+        }
+
+        stateNode = node->pragmaStateNode;
+        node->datasetIndex = datasetIndex;
+        node->graphType = graphType;
+        node->applyPragmaState();
+
+        if (!node->pragmaVariable.empty()) {
+            variableMapper->reapplyArrayPragmas(node);
+        }
+    }
+
+    for (; eventIndex < builtGraph->numPragmaEvents; eventIndex++) {
+        if (!pragmaParser->replayEvent(events[eventIndex])) {
+            return false;
+        }
+    }
+
+    astParser->markInlinedFunctions(false);
+    astParser->registerFunctionCalls();
+
+    stateNode = builtGraph->stateNode;
+
+    // keep the reannotated graph as the one to print
+    saveBuiltGraph();
+    resolveGraph();
+
+    return true;
 }
 
 } // namespace Balor
@@ -1,15 +1,24 @@
 #ifndef BALOR_GRAPH_GENERATOR_H
 #define BALOR_GRAPH_GENERATOR_H
 
+#include "../useDefIndex.h"
+#include "args.h"
 #include "astParser.h"
 #include "derefTracker.h"
 #include "edge.h"
+#include "flatGraph.h"
+#include "graphArena.h"
+#include "graphCompaction.h"
+#include "graphWriter.h"
+#include "loopTree.h"
 #include "node.h"
 #include "pragmaParser.h"
 #include "rose.h"
 #include "variableMapper.h"
 #include <memory>
 #include <queue>
+#include <tuple>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace Balor {
@@ -20,25 +29,63 @@ class DerefTracker;
 class AstParser;
 
 class Node;
+class LoopNode;
 class Edge;
 
 class GraphGenerator {
   public:
-    GraphGenerator(Sawyer::CommandLine::ParserResult parserResult);
-
+    // nodes and edges are made in the arena if one is given, so its memory can be reused
+    // for the next graph, graphs sharing an arena must be destroyed in the reverse order they were made
+    // a config turns its switches on and sets its graph type, see --configs
+    GraphGenerator(Sawyer::CommandLine::ParserResult parserResult, GraphArena *arena = nullptr,
+                   const GraphConfig *config = nullptr);
+    ~GraphGenerator();
+
+    // Build the graph from the AST, then resolve it into flatGraph
     void generateGraph(SgFunctionDefinition *topLevelFuncDef);
+
+    // Write the resolved graph, as often as needed, in the first output format or with another writer
     void printGraph();
+    void printGraph(GraphWriter &graphWriter);
+
+    // Set the pragma fields of the built graph again from the current pragma text,
+    // without parsing the AST again. Only possible when pragmas are absorbed into
+    // the nodes, and when no call site is inlined differently than when built,
+    // returns false otherwise and the graph must be generated again
+    bool reannotatePragmas();
 
     std::unique_ptr<VariableMapper> variableMapper;
     std::unique_ptr<PragmaParser> pragmaParser;
     std::unique_ptr<DerefTracker> derefTracker;
     std::unique_ptr<AstParser> astParser;
 
+    // one for each output format, dot or bin
+    std::vector<std::unique_ptr<GraphWriter>> graphWriters;
+
+    // the resolved graph, with every edge in its final form, which the graph writers write out
+    FlatGraph flatGraph;
+
+    // made from the resolved graph, for --add_cfg
+    BasicBlockGraph basicBlockGraph;
+
+    // made from the resolved graph and the loops, for --add_loop_tree
+    LoopTree loopTree;
+
+    // what --compact removed from the resolved graph
+    CompactionStats compactionStats;
+
+    // with --max_nodes, the switches turned on to fit the resolved graph in the budget, in the order they were
+    std::vector<std::string> appliedReductions;
+
+    GraphArena *arena;
+
     std::vector<Node *> nodes;
-    std::vector<std::unique_ptr<Node>> nodes_unq;
+    // every node made for this graph, in the arena, destroyed with the graph
+    std::vector<Node *> allocatedNodes;
 
     std::vector<Edge *> edges;
-    std::vector<std::unique_ptr<Edge>> edges_unq;
+    // every edge made for this graph, in the arena, destroyed with the graph
+    std::vector<Edge *> allocatedEdges;
 
     bool checkArg(const std::string &arg);
 
@@ -52,6 +99,16 @@ class GraphGenerator {
     int getFunctionID();
     void enterNewFunction();
 
+    // the innermost loop being parsed, 0 outside every loop
+    int getLoopID();
+    // a loop starts at its condition, the body is where its pragmas apply
+    void enterLoop();
+    void enterLoopBody();
+    void exitLoop();
+
+    // every loop of the graph, made when its body is entered
+    std::vector<LoopNode *> loopNodes;
+
     SgFunctionDeclaration *getFuncDec();
     void setFuncDec(SgFunctionDeclaration *funcDec);
 
@@ -61,6 +118,8 @@ class GraphGenerator {
 
     void setFuncInlined(SgFunctionDeclaration *funcDec, bool inlined);
     bool getFuncInlined(SgFunctionDeclaration *funcDec);
+    // go back to which functions were inlined before inline pragmas were applied
+    void resetFuncsInlined();
 
     int getCallsNums(SgFunctionDeclaration *funcDec);
     int getCallSiteNums(SgFunctionDeclaration *funcDec);
@@ -68,6 +127,40 @@ class GraphGenerator {
     std::string datasetIndex;
     std::string graphType;
 
+    // What the nodes and edges of the graph share while it is built,
+    // kept per graph so one build never sees another's
+    struct BuildState {
+        // the ID the next printed node gets
+        int nodeID = 0;
+
+        // the last node in the control flow, and the edges waiting to hear what the next one is
+        Node *previousControlFlowNode = nullptr;
+        std::queue<Edge *> previousControlFlowNodeChangeListeners;
+
+        // with --intern_types, the type node shared by each type, constness and BB
+        std::map<std::tuple<std::string, bool, int>, Node *> typeNodes;
+
+        // the node printed with each ID
+        std::unordered_map<int, Node *> printedNodes;
+    };
+    BuildState buildState;
+
+    // the variable uses of each function definition the graph has looked at
+    UseDefIndices useDefIndices;
+
+    // Make a graph the one nodes and edges on this thread are made for, while in scope,
+    // so graphs can be built one after another, or at the same time on different threads
+    class CurrentGraph {
+      public:
+        CurrentGraph(GraphGenerator *graphGenerator);
+        ~CurrentGraph();
+
+      private:
+        GraphGenerator *previousNodesGraph;
+        GraphGenerator *previousEdgesGraph;
+        UseDefIndices *previousUseDefIndices;
+    };
+
   private:
     // used to specify which function a node belongs to
     // for grouping on pdf
@@ -79,15 +172,69 @@ class GraphGenerator {
 
     bool bbEmpty = true;
 
+    int numLoops = 0;
+    std::vector<int> loopStack;
+
     SgFunctionDeclaration *funcDec = nullptr;
 
     std::map<SgFunctionDeclaration *, int> funcDecsToCallNums;
     std::map<SgFunctionDeclaration *, int> funcDecsToCallSiteNums;
 
     std::map<SgFunctionDeclaration *, bool> isDecInlined;
+    std::map<SgFunctionDeclaration *, bool> isDecInlinedDefaults;
+    bool inlinedDefaultsSaved = false;
 
 
     std::map<std::string, bool> argMap;
+
+    // the most nodes the resolved graph should have, 0 if there is no budget
+    uint32_t maxNodes = 0;
+
+    // the arena made for this graph when none was given
+    std::unique_ptr<GraphArena> ownArena;
+    GraphArena::Mark arenaStart;
+
+    // destroy the nodes and edges made after the first numNodes and numEdges
+    void destroyAllocated(size_t numNodes, size_t numEdges);
+
+    // Run the nodes and deferred edges of the built graph into flatGraph.
+    // this adds nodes and edges and changes some parsing state,
+    // so the state after building is kept to resolve again
+    void resolveGraph();
+    // resolve once with the switches as they are
+    void resolveFlatGraph();
+    // go back to the switches given, before any were turned on for --max_nodes
+    void clearReductions();
+    // from the loop nodes, which have the pragma state of each loop
+    void buildLoopTree();
+
+    void saveBuiltGraph();
+    void restoreBuiltGraph();
+
+    struct BuiltGraph {
+        std::vector<Node *> nodes;
+        std::vector<Edge *> edges;
+        size_t numNodes = 0;
+        size_t numEdges = 0;
+        GraphArena::Mark arenaMark;
+        int numPragmaEvents = 0;
+
+        std::string groupName;
+        int bbID = 0;
+        int functionID = 0;
+        bool bbEmpty = true;
+        SgFunctionDeclaration *funcDec = nullptr;
+        Node *stateNode = nullptr;
+
+        std::map<SgFunctionDeclaration *, int> funcDecsToCallNums;
+        std::map<SgFunctionDeclaration *, int> funcDecsToCallSiteNums;
+
+        std::map<SgInitializedName *, Node *> variableToWriteNode;
+        std::map<SgInitializedName *, Node *> variableToReadNode;
+        std::set<Node *> nonReadVariables;
+        std::map<SgInitializedName *, SgInitializedName *> underlyingVariableMap;
+    };
+    std::unique_ptr<BuiltGraph> builtGraph;
 };
 } // namespace Balor
 
@@ -0,0 +1,108 @@
+#include "graphStats.h"
+#include "graphGenerator.h"
+#include "node.h"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// the flowType attribute that makes each FlowType
+const char *getFlowTypeName(Balor::FlowType flowType) {
+    static const char *names[] = {"control", "call", "dataflow", "address", "pragma", "other"};
+    return names[int(flowType)];
+}
+
+std::string toName(const std::string &name) { return name; }
+std::string toName(int id) { return std::to_string(id); }
+
+// the nodes and edges of each function or BB
+template <typename Key>
+boost::property_tree::ptree makeCounts(const std::map<Key, std::pair<uint32_t, uint32_t>> &counts) {
+    boost::property_tree::ptree tree;
+    for (const auto &count : counts) {
+        boost::property_tree::ptree entry;
+        entry.put("nodes", count.second.first);
+        entry.put("edges", count.second.second);
+        // names can have dots in them, which put would take as a path
+        tree.push_back(std::make_pair(toName(count.first), entry));
+    }
+    return tree;
+}
+
+} // namespace
+
+namespace Balor {
+
+void writeGraphStats(GraphGenerator &graphGenerator, std::ostream &out) {
+    const FlatGraph &graph = graphGenerator.flatGraph;
+    const std::unordered_map<int, Node *> &printedNodes = graphGenerator.buildState.printedNodes;
+    const std::vector<int> &printIDs = graph.getNodePrintIDs();
+    const std::vector<int> &bbIDs = graph.getNodeBBIDs();
+
+    std::map<std::string, uint32_t> nodeVariants;
+    std::map<std::string, std::pair<uint32_t, uint32_t>> functions;
+    std::map<int, std::pair<uint32_t, uint32_t>> bbs;
+    float maxUnrollFactor = 1;
+
+    // the function of each node, implicit nodes were never printed so don't have one
+    std::vector<std::string> nodeFunctions(graph.getNumNodes(), "implicit");
+    for (uint32_t node = 0; node < graph.getNumNodes(); node++) {
+        auto printed = printedNodes.find(printIDs[node]);
+        if (!graph.isImplicit(node) && printed != printedNodes.end()) {
+            nodeVariants[getVariantName(printed->second->getVariant())]++;
+            nodeFunctions[node] = printed->second->groupName;
+            maxUnrollFactor = std::max(maxUnrollFactor, printed->second->unrollFactor.full);
+        }
+        functions[nodeFunctions[node]].first++;
+        bbs[bbIDs[node]].first++;
+    }
+
+    std::map<std::string, uint32_t> flowTypes;
+    for (uint32_t edge = 0; edge < graph.getNumEdges(); edge++) {
+        uint32_t source = graph.getEdgeSources()[edge];
+        flowTypes[getFlowTypeName(graph.getEdgeFlowTypes()[edge])]++;
+        functions[nodeFunctions[source]].second++;
+        bbs[bbIDs[source]].second++;
+    }
+
+    // a loop is made after the loop it is in, so its parent's depth is already known
+    std::map<int, int> loopDepths = {{0, 0}};
+    int maxLoopDepth = 0;
+    for (LoopNode *loopNode : graphGenerator.loopNodes) {
+        int depth = loopDepths[loopNode->parentLoop] + 1;
+        loopDepths[loopNode->loop] = depth;
+        maxLoopDepth = std::max(maxLoopDepth, depth);
+    }
+
+    boost::property_tree::ptree stats;
+    stats.put("numNodes", graph.getNumNodes());
+    stats.put("numEdges", graph.getNumEdges());
+
+    boost::property_tree::ptree variantCounts;
+    for (const auto &count : nodeVariants) {
+        variantCounts.put(count.first, count.second);
+    }
+    stats.add_child("nodeVariants", variantCounts);
+
+    boost::property_tree::ptree flowTypeCounts;
+    for (const auto &count : flowTypes) {
+        flowTypeCounts.put(count.first, count.second);
+    }
+    stats.add_child("flowTypes", flowTypeCounts);
+
+    stats.add_child("functions", makeCounts(functions));
+    stats.add_child("bbs", makeCounts(bbs));
+    stats.put("maxLoopDepth", maxLoopDepth);
+    stats.put("maxUnrollFactor", maxUnrollFactor);
+
+    boost::property_tree::write_json(out, stats);
+}
+
+} // namespace Balor
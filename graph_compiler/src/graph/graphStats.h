@@ -0,0 +1,25 @@
+#ifndef BALOR_GRAPH_STATS_H
+#define BALOR_GRAPH_STATS_H
+
+#include <ostream>
+
+namespace Balor {
+
+class GraphGenerator;
+
+// Write counts that describe the resolved graph as JSON, for --stats:
+// - numNodes and numEdges
+// - nodeVariants, the printed nodes of each NodeVariant
+// - flowTypes, the edges of each flow type: control, call, dataflow, address, pragma and other
+// - functions and bbs, the nodes and edges of each function (groupName) and BB,
+//   an edge counts towards the function and BB of its source, nodes that were never printed themselves,
+//   only referred to by an edge, are in the function "implicit"
+// - maxLoopDepth, the most loops nested in each other, 0 without loops
+// - maxUnrollFactor, the largest unrollFactor.full of a printed node
+//
+// property_tree writes every value as a string
+void writeGraphStats(GraphGenerator &graphGenerator, std::ostream &out);
+
+} // namespace Balor
+
+#endif
@@ -0,0 +1,453 @@
+#include "graphWriter.h"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+void output(const std::string &content) { std::cout << content << std::endl; }
+
+// name="value" for each attribute the node or edge has, in order of name
+std::string attributesToString(const Balor::FlatGraph &graph, const std::vector<const Balor::FlatGraph::Column *> &columns,
+                               uint32_t row) {
+    const Balor::StringTable &strings = graph.getStrings();
+
+    std::string out;
+    for (const Balor::FlatGraph::Column *column : columns) {
+        uint32_t value = column->values[row];
+        if (value == Balor::FlatGraph::NO_VALUE) {
+            continue;
+        }
+        out += strings.get(column->name);
+        out += "=\"";
+        out += strings.get(value);
+        out += "\" ";
+    }
+    return out;
+}
+
+// the format is little-endian whatever machine writes it
+template <typename T, typename U> void writeLittleEndian(std::string &buffer, T value) {
+    U bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (size_t i = 0; i < sizeof(bits); i++) {
+        buffer.push_back(char((bits >> (8 * i)) & 0xff));
+    }
+}
+
+void writeInt32(std::string &buffer, int32_t value) { writeLittleEndian<int32_t, uint32_t>(buffer, value); }
+void writeUint32(std::string &buffer, uint32_t value) { writeLittleEndian<uint32_t, uint32_t>(buffer, value); }
+void writeFloat32(std::string &buffer, float value) { writeLittleEndian<float, uint32_t>(buffer, value); }
+void writeInt64(std::string &buffer, int64_t value) { writeLittleEndian<int64_t, uint64_t>(buffer, value); }
+
+void align(std::string &buffer) {
+    while (buffer.size() % 8) {
+        buffer.push_back('\0');
+    }
+}
+
+// space separated, the way DOT graph attributes hold arrays
+std::string joinInts(const std::vector<int> &values) {
+    std::string out;
+    for (int value : values) {
+        out += std::to_string(value) + " ";
+    }
+    return out;
+}
+
+enum class ColumnType { INT32, FLOAT32, STRING };
+
+// every node and edge attribute the graph compiler prints, the same columns in every graph
+// so datasets can be stacked without looking at each graph's schema
+struct SchemaColumn {
+    const char *name;
+    ColumnType type;
+};
+
+const SchemaColumn NODE_SCHEMA[] = {
+    {"arrayWidth0", ColumnType::INT32},       {"arrayWidth1", ColumnType::INT32},
+    {"arrayWidth2", ColumnType::INT32},       {"arrayWidth3", ColumnType::INT32},
+    {"arrayWidth4", ColumnType::INT32},       {"bbID", ColumnType::INT32},
+    {"bitwidth", ColumnType::INT32},          {"datasetIndex", ColumnType::STRING},
+    {"datatype", ColumnType::STRING},         {"fillcolor", ColumnType::STRING},
+    {"fullUnrollFactor", ColumnType::FLOAT32}, {"funcID", ColumnType::INT32},
+    {"graphType", ColumnType::STRING},        {"group", ColumnType::STRING},
+    {"inlined", ColumnType::INT32},           {"keyText", ColumnType::STRING},
+    {"label", ColumnType::STRING},            {"nodeType", ColumnType::STRING},
+    {"numCallSites", ColumnType::INT32},      {"numCalls", ColumnType::INT32},
+    {"numeric", ColumnType::INT32},           {"partition1", ColumnType::STRING},
+    {"partition2", ColumnType::STRING},       {"partition3", ColumnType::STRING},
+    {"partitionFactor1", ColumnType::INT32},  {"partitionFactor2", ColumnType::INT32},
+    {"partitionFactor3", ColumnType::INT32},  {"pipelined", ColumnType::INT32},
+    {"pipelinedType", ColumnType::INT32},     {"previouslyPipelined", ColumnType::INT32},
+    {"resourceType", ColumnType::STRING},     {"shape", ColumnType::STRING},
+    {"tile", ColumnType::INT32},              {"totalArrayWidth", ColumnType::INT32},
+    {"tripcount", ColumnType::FLOAT32},       {"unrollFactor1", ColumnType::FLOAT32},
+    {"unrollFactor2", ColumnType::FLOAT32},   {"unrollFactor3", ColumnType::FLOAT32},
+};
+
+const SchemaColumn EDGE_SCHEMA[] = {
+    {"color", ColumnType::STRING},    {"dir", ColumnType::STRING},   {"edgeOrder", ColumnType::INT32},
+    {"flowType", ColumnType::STRING}, {"style", ColumnType::STRING}, {"xlabel", ColumnType::STRING},
+};
+
+// what a node or edge without the attribute has
+constexpr int32_t MISSING_INT32 = INT32_MIN;
+constexpr int32_t MISSING_STRING = -1;
+
+std::runtime_error badValue(const std::string &name, const std::string &value, const std::string &type) {
+    return std::runtime_error("Attribute " + name + " is in the binary schema as " + type + ", but has value \"" +
+                              value + "\"");
+}
+
+int32_t toInt32(const std::string &name, const std::string &value) {
+    try {
+        size_t end;
+        long parsed = std::stol(value, &end);
+        if (end == value.size() && parsed >= INT32_MIN && parsed <= INT32_MAX) {
+            return int32_t(parsed);
+        }
+    } catch (...) {
+    }
+    throw badValue(name, value, "int32");
+}
+
+float toFloat32(const std::string &name, const std::string &value) {
+    try {
+        size_t end;
+        float parsed = std::stof(value, &end);
+        if (end == value.size()) {
+            return parsed;
+        }
+    } catch (...) {
+    }
+    throw badValue(name, value, "float32");
+}
+
+// a column to write, its name and the interned value of each node or edge
+using ColumnView = std::pair<std::string, const std::vector<uint32_t> *>;
+
+std::vector<ColumnView> getColumnViews(const Balor::FlatGraph &graph,
+                                       const std::vector<Balor::FlatGraph::Column> &columns) {
+    std::vector<ColumnView> views;
+    for (const Balor::FlatGraph::Column &column : columns) {
+        views.push_back(ColumnView(graph.getStrings().get(column.name), &column.values));
+    }
+    return views;
+}
+
+// write every column of the schema to data, and describe them
+// each interned value is converted once, the same few values repeat over most of a column
+template <size_t N>
+boost::property_tree::ptree writeColumns(const Balor::StringTable &strings, const SchemaColumn (&schema)[N],
+                                         const std::vector<ColumnView> &views, uint32_t count, std::string &data) {
+    std::unordered_map<std::string, const std::vector<uint32_t> *> byName;
+    for (const ColumnView &view : views) {
+        byName[view.first] = view.second;
+    }
+    for (const ColumnView &view : views) {
+        auto found = std::find_if(std::begin(schema), std::end(schema),
+                                  [&](const SchemaColumn &column) { return view.first == column.name; });
+        if (found == std::end(schema)) {
+            throw std::runtime_error("Attribute " + view.first + " isn't in the binary schema");
+        }
+    }
+
+    boost::property_tree::ptree columns;
+    for (const SchemaColumn &schemaColumn : schema) {
+        auto view = byName.find(schemaColumn.name);
+        const std::vector<uint32_t> *values = view == byName.end() ? nullptr : view->second;
+
+        boost::property_tree::ptree column;
+        column.put("name", schemaColumn.name);
+        column.put("offset", data.size());
+
+        std::unordered_map<uint32_t, int32_t> ints;
+        std::unordered_map<uint32_t, float> floats;
+        std::unordered_map<uint32_t, int32_t> codes;
+        boost::property_tree::ptree categories;
+
+        for (uint32_t row = 0; row < count; row++) {
+            uint32_t value = values ? (*values)[row] : Balor::FlatGraph::NO_VALUE;
+
+            if (schemaColumn.type == ColumnType::INT32) {
+                if (value == Balor::FlatGraph::NO_VALUE) {
+                    writeInt32(data, MISSING_INT32);
+                    continue;
+                }
+                auto converted = ints.find(value);
+                if (converted == ints.end()) {
+                    converted = ints.emplace(value, toInt32(schemaColumn.name, strings.get(value))).first;
+                }
+                writeInt32(data, converted->second);
+            } else if (schemaColumn.type == ColumnType::FLOAT32) {
+                if (value == Balor::FlatGraph::NO_VALUE) {
+                    writeFloat32(data, std::numeric_limits<float>::quiet_NaN());
+                    continue;
+                }
+                auto converted = floats.find(value);
+                if (converted == floats.end()) {
+                    converted = floats.emplace(value, toFloat32(schemaColumn.name, strings.get(value))).first;
+                }
+                writeFloat32(data, converted->second);
+            } else {
+                if (value == Balor::FlatGraph::NO_VALUE) {
+                    writeInt32(data, MISSING_STRING);
+                    continue;
+                }
+                // codes in order of first use, the string of each is in the schema
+                auto converted = codes.find(value);
+                if (converted == codes.end()) {
+                    converted = codes.emplace(value, codes.size()).first;
+
+                    boost::property_tree::ptree category;
+                    category.put("", strings.get(value));
+                    categories.push_back(std::make_pair("", category));
+                }
+                writeInt32(data, converted->second);
+            }
+        }
+        align(data);
+
+        if (schemaColumn.type == ColumnType::INT32) {
+            column.put("dtype", "int32");
+        } else if (schemaColumn.type == ColumnType::FLOAT32) {
+            column.put("dtype", "float32");
+        } else {
+            column.put("dtype", "string");
+            column.add_child("categories", categories);
+        }
+
+        columns.push_back(std::make_pair("", column));
+    }
+    return columns;
+}
+
+} // namespace
+
+namespace Balor {
+
+std::unique_ptr<GraphWriter> makeGraphWriter(const std::string &format) {
+    if (format == "dot") {
+        return std::make_unique<DotWriter>();
+    }
+    if (format == "bin") {
+        return std::make_unique<BinaryWriter>();
+    }
+    throw std::invalid_argument("Unknown output format: " + format + ", expected dot or bin");
+}
+
+void DotWriter::write(const FlatGraph &graph, BasicBlockGraph *basicBlockGraph, LoopTree *loopTree) {
+    const StringTable &strings = graph.getStrings();
+    const std::vector<int> &printIDs = graph.getNodePrintIDs();
+    const std::vector<uint32_t> &sources = graph.getEdgeSources();
+    const std::vector<uint32_t> &destinations = graph.getEdgeDestinations();
+
+    std::vector<const FlatGraph::Column *> nodeColumns = graph.sortedByName(graph.getNodeColumns());
+    std::vector<const FlatGraph::Column *> edgeColumns = graph.sortedByName(graph.getEdgeColumns());
+
+    // make a directed graph
+    output("digraph {");
+    output("newrank=\"true\";");
+
+    // in the order they were printed
+    for (const FlatGraph::Item &item : graph.getItems()) {
+        if (item.kind == FlatGraph::ItemKind::NODE) {
+            std::string out = "node" + std::to_string(printIDs[item.index]);
+            out += " [";
+            out += "style=filled fillcolor=\"" + strings.get(graph.getNodeColors()[item.index]) + "\" ";
+            out += attributesToString(graph, nodeColumns, item.index);
+            out += "]";
+            output(out);
+        } else if (item.kind == FlatGraph::ItemKind::EDGE) {
+            std::string out = "node" + std::to_string(printIDs[sources[item.index]]) + " -> node" +
+                              std::to_string(printIDs[destinations[item.index]]);
+            out += "[";
+            out += attributesToString(graph, edgeColumns, item.index);
+            out += "]";
+            output(out);
+        } else {
+            // put the node at the top of its function's subgraph, only matters for drawing
+            const FlatGraph::TopOfGroup &top = graph.getTopsOfGroups()[item.index];
+            output("subgraph cluster_" + strings.get(top.groupName) + " {");
+            output("{rank=min; node" + std::to_string(printIDs[top.node]) + "}");
+            output("}");
+        }
+    }
+
+    if (basicBlockGraph) {
+        std::string edges;
+        for (const std::pair<int, int> &edge : basicBlockGraph->getEdges()) {
+            edges += std::to_string(edge.first) + " " + std::to_string(edge.second) + " ";
+        }
+
+        output("cfgNumBBs=\"" + std::to_string(basicBlockGraph->getNumBBs()) + "\";");
+        output("cfgEdges=\"" + edges + "\";");
+        output("nodeBBs=\"" + joinInts(basicBlockGraph->getNodeBBs()) + "\";");
+    }
+
+    if (loopTree) {
+        std::string parents, functions, tripcounts, unrollFactors, pipelined, pipelinedTypes;
+        for (const LoopTree::Loop &loop : loopTree->getLoops()) {
+            parents += std::to_string(loop.parent) + " ";
+            functions += std::to_string(loop.functionID) + " ";
+            tripcounts += std::to_string(loop.tripcount) + " ";
+            unrollFactors += std::to_string(loop.unrollFactor) + " ";
+            pipelined += std::to_string(int(loop.pipelined)) + " ";
+            pipelinedTypes += std::to_string(loop.pipelinedType) + " ";
+        }
+        output("loopNumLoops=\"" + std::to_string(loopTree->getNumLoops()) + "\";");
+        output("loopParents=\"" + parents + "\";");
+        output("loopFunctions=\"" + functions + "\";");
+        output("loopTripcounts=\"" + tripcounts + "\";");
+        output("loopUnrollFactors=\"" + unrollFactors + "\";");
+        output("loopPipelined=\"" + pipelined + "\";");
+        output("loopPipelinedTypes=\"" + pipelinedTypes + "\";");
+        output("nodeLoops=\"" + joinInts(loopTree->getNodeLoops()) + "\";");
+        output("bbLoops=\"" + joinInts(loopTree->getBBLoops()) + "\";");
+    }
+
+    for (const std::pair<const std::string, std::string> &attribute : graph.getGraphAttributes()) {
+        output(attribute.first + "=\"" + attribute.second + "\";");
+    }
+
+    // close the directed graph
+    output("}");
+}
+
+void BinaryWriter::write(const FlatGraph &graph, BasicBlockGraph *basicBlockGraph, LoopTree *loopTree) {
+    // rows are node indices, so every node needs its attributes
+    for (uint32_t node = 0; node < graph.getNumNodes(); node++) {
+        if (graph.isImplicit(node)) {
+            throw std::runtime_error("Edge has a node that was never written: node" +
+                                     std::to_string(graph.getNodePrintIDs()[node]));
+        }
+    }
+
+    std::string data;
+
+    // the fill color is a node attribute like any other here
+    std::vector<ColumnView> nodeViews;
+    for (const ColumnView &view : getColumnViews(graph, graph.getNodeColumns())) {
+        if (view.first != "fillcolor") {
+            nodeViews.push_back(view);
+        }
+    }
+    nodeViews.push_back(ColumnView("fillcolor", &graph.getNodeColors()));
+
+    boost::property_tree::ptree schema;
+    schema.add_child("nodes", writeColumns(graph.getStrings(), NODE_SCHEMA, nodeViews, graph.getNumNodes(), data));
+
+    schema.put("edgeIndex", data.size());
+    for (uint32_t source : graph.getEdgeSources()) {
+        writeInt64(data, source);
+    }
+    for (uint32_t destination : graph.getEdgeDestinations()) {
+        writeInt64(data, destination);
+    }
+
+    schema.add_child("edges", writeColumns(graph.getStrings(), EDGE_SCHEMA, getColumnViews(graph, graph.getEdgeColumns()),
+                                           graph.getNumEdges(), data));
+
+    if (basicBlockGraph) {
+        boost::property_tree::ptree cfg;
+        cfg.put("numBBs", basicBlockGraph->getNumBBs());
+        cfg.put("numEdges", basicBlockGraph->getEdges().size());
+
+        cfg.put("edgeIndex", data.size());
+        for (const std::pair<int, int> &edge : basicBlockGraph->getEdges()) {
+            writeInt64(data, edge.first);
+        }
+        for (const std::pair<int, int> &edge : basicBlockGraph->getEdges()) {
+            writeInt64(data, edge.second);
+        }
+
+        cfg.put("nodeBBs", data.size());
+        for (int bb : basicBlockGraph->getNodeBBs()) {
+            writeInt64(data, bb);
+        }
+
+        schema.add_child("cfg", cfg);
+    }
+
+    if (loopTree) {
+        const std::vector<LoopTree::Loop> &loops = loopTree->getLoops();
+
+        boost::property_tree::ptree loopSchema;
+        loopSchema.put("numLoops", loops.size());
+        loopSchema.put("numBBs", loopTree->getBBLoops().size());
+
+        loopSchema.put("parents", data.size());
+        for (const LoopTree::Loop &loop : loops) {
+            writeInt64(data, loop.parent);
+        }
+        loopSchema.put("functions", data.size());
+        for (const LoopTree::Loop &loop : loops) {
+            writeInt64(data, loop.functionID);
+        }
+        loopSchema.put("tripcounts", data.size());
+        for (const LoopTree::Loop &loop : loops) {
+            writeFloat32(data, loop.tripcount);
+        }
+        align(data);
+        loopSchema.put("unrollFactors", data.size());
+        for (const LoopTree::Loop &loop : loops) {
+            writeFloat32(data, loop.unrollFactor);
+        }
+        align(data);
+        loopSchema.put("pipelined", data.size());
+        for (const LoopTree::Loop &loop : loops) {
+            writeInt64(data, loop.pipelined);
+        }
+        loopSchema.put("pipelinedTypes", data.size());
+        for (const LoopTree::Loop &loop : loops) {
+            writeInt64(data, loop.pipelinedType);
+        }
+
+        loopSchema.put("nodeLoops", data.size());
+        for (int loop : loopTree->getNodeLoops()) {
+            writeInt64(data, loop);
+        }
+        loopSchema.put("bbLoops", data.size());
+        for (int loop : loopTree->getBBLoops()) {
+            writeInt64(data, loop);
+        }
+
+        schema.add_child("loops", loopSchema);
+    }
+
+    if (!graph.getGraphAttributes().empty()) {
+        boost::property_tree::ptree graphAttributes;
+        for (const std::pair<const std::string, std::string> &attribute : graph.getGraphAttributes()) {
+            graphAttributes.push_back(std::make_pair(attribute.first, boost::property_tree::ptree(attribute.second)));
+        }
+        schema.add_child("graph", graphAttributes);
+    }
+
+    std::ostringstream schemaStream;
+    boost::property_tree::write_json(schemaStream, schema, false);
+
+    // offsets in the schema are from the start of the data, which follows the padded schema
+    std::string schemaText = schemaStream.str();
+    align(schemaText);
+
+    std::string header = std::string("BALORGR", 8);
+    writeUint32(header, 2);
+    writeUint32(header, schemaText.size());
+    writeUint32(header, graph.getNumNodes());
+    writeUint32(header, graph.getNumEdges());
+
+    std::cout << header << schemaText << data << std::flush;
+}
+
+} // namespace Balor
@@ -0,0 +1,73 @@
+#ifndef BALOR_GRAPH_WRITER_H
+#define BALOR_GRAPH_WRITER_H
+
+#include "basicBlockGraph.h"
+#include "flatGraph.h"
+#include "loopTree.h"
+
+#include <memory>
+#include <string>
+
+namespace Balor {
+
+// Writes a printed graph to std::cout in one of the output formats
+class GraphWriter {
+  public:
+    virtual ~GraphWriter() = default;
+
+    // with the control flow graph between basic blocks, and the basic block of each node, if there is one,
+    // and the loop nest, and the loop of each node and basic block, if there is one
+    virtual void write(const FlatGraph &graph, BasicBlockGraph *basicBlockGraph, LoopTree *loopTree) = 0;
+
+    // extension of files written in this format
+    virtual std::string getExtension() = 0;
+};
+
+// make the writer for a --format argument
+std::unique_ptr<GraphWriter> makeGraphWriter(const std::string &format);
+
+// The DOT graph description language
+// the basic block graph is written as graph attributes: cfgNumBBs, cfgEdges (source target pairs) and nodeBBs
+// the loop tree is written as graph attributes too: loopNumLoops, then a space separated value per loop,
+// loopParents, loopFunctions, loopTripcounts, loopUnrollFactors, loopPipelined and loopPipelinedTypes,
+// then a loop index per node and per BB, nodeLoops and bbLoops
+// followed by the graph's own attributes, e.g. maxNodes and reductions with --max_nodes
+class DotWriter : public GraphWriter {
+  public:
+    void write(const FlatGraph &graph, BasicBlockGraph *basicBlockGraph, LoopTree *loopTree) override;
+
+    std::string getExtension() override { return ".dot"; }
+};
+
+// A little-endian columnar format that numpy can map without copying
+//
+// header: 8 byte magic "BALORGR\0", then uint32 version, schema size, node count and edge count
+// schema: JSON describing each column, {"nodes": [...], "edges": [...]}, with its name, dtype
+//         ("int32", "float32" or "string"), byte offset and, for strings, the list of strings the codes index
+// data:   each column starts 8 byte aligned, the edge index is an int64 (2, edges) array
+//         of node indices, which are the order nodes were written in
+//
+// every graph has the same columns with the same dtypes, the fixed schema in graphWriter.cpp,
+// a node or edge without the attribute has INT32_MIN in an int32 column, NaN in a float32 one
+// and -1 in a string one
+// string columns are int32 codes into the column's list of strings, numbered in order of first use in the graph,
+// so a string's code differs between graphs, map codes through the list to compare them
+//
+// with --add_cfg the schema also has "cfg": the number of BBs, the offset of an int64 (2, BB edges) array
+// and the offset of an int64 array with the BB index of each node
+//
+// with --add_loop_tree the schema also has "loops": the number of loops and BBs, the offset of an array per loop,
+// parents, functions, pipelined and pipelinedTypes as int64, tripcounts and unrollFactors as float32,
+// and the offsets of int64 arrays with the loop index of each node, nodeLoops, and of each BB, bbLoops
+//
+// the graph's own attributes are "graph": an object of strings, when it has any
+class BinaryWriter : public GraphWriter {
+  public:
+    void write(const FlatGraph &graph, BasicBlockGraph *basicBlockGraph, LoopTree *loopTree) override;
+
+    std::string getExtension() override { return ".bin"; }
+};
+
+} // namespace Balor
+
+#endif
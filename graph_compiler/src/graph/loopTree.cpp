@@ -0,0 +1,93 @@
+#include "loopTree.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace Balor {
+
+void LoopTree::clear() {
+    loops.clear();
+    depths.clear();
+    nodeLoops.clear();
+    bbLoops.clear();
+}
+
+void LoopTree::addLoop(int loopID, int parentLoopID, const Loop &loop) {
+    if (loopID < 1 || parentLoopID >= loopID) {
+        throw std::runtime_error("Loop " + std::to_string(loopID) + " can't be in loop " +
+                                 std::to_string(parentLoopID));
+    }
+
+    if (int(loops.size()) < loopID) {
+        loops.resize(loopID);
+    }
+    loops[loopID - 1] = loop;
+    loops[loopID - 1].parent = parentLoopID - 1;
+}
+
+void LoopTree::build(const FlatGraph &graph) {
+    // loops are numbered before their bodies are parsed, so a parent always comes first
+    depths.assign(loops.size(), 0);
+    for (size_t loop = 0; loop < loops.size(); loop++) {
+        if (loops[loop].parent >= 0) {
+            depths[loop] = depths[loops[loop].parent] + 1;
+        }
+    }
+
+    nodeLoops.clear();
+    bbLoops.clear();
+
+    const std::vector<int> &bbIDs = graph.getNodeBBIDs();
+    const std::vector<int> &loopIDs = graph.getNodeLoopIDs();
+
+    int numBBs = 0;
+    for (uint32_t node = 0; node < graph.getNumNodes(); node++) {
+        if (!graph.isImplicit(node)) {
+            numBBs = std::max(numBBs, bbIDs[node]);
+        }
+    }
+    std::vector<bool> bbSeen(numBBs, false);
+    bbLoops.assign(numBBs, -1);
+
+    for (uint32_t node = 0; node < graph.getNumNodes(); node++) {
+        if (graph.isImplicit(node)) {
+            nodeLoops.push_back(-1);
+            continue;
+        }
+
+        int loop = loopIDs[node] - 1;
+        if (loop >= int(loops.size())) {
+            throw std::runtime_error("Node is in loop " + std::to_string(loopIDs[node]) + ", which was never added");
+        }
+        nodeLoops.push_back(loop);
+
+        // a BB can go on past the end of a loop, e.g. after a while loop
+        int bb = bbIDs[node] - 1;
+        if (bb < 0) {
+            continue;
+        }
+        if (!bbSeen[bb]) {
+            bbLoops[bb] = loop;
+            bbSeen[bb] = true;
+        } else {
+            bbLoops[bb] = getCommonLoop(bbLoops[bb], loop);
+        }
+    }
+}
+
+int LoopTree::getDepth(int loop) { return loop < 0 ? -1 : depths[loop]; }
+
+// the innermost loop both loops are in
+int LoopTree::getCommonLoop(int loop1, int loop2) {
+    while (loop1 != loop2) {
+        if (getDepth(loop1) >= getDepth(loop2)) {
+            loop1 = loops[loop1].parent;
+        } else {
+            loop2 = loops[loop2].parent;
+        }
+    }
+    return loop1;
+}
+
+} // namespace Balor
@@ -0,0 +1,55 @@
+#ifndef BALOR_LOOP_TREE_H
+#define BALOR_LOOP_TREE_H
+
+#include "flatGraph.h"
+
+#include <vector>
+
+namespace Balor {
+
+// The loop nest, and the innermost loop of each node and basic block of the printed graph
+// loop indices are loopID - 1, as the first loop has ID 1, -1 is outside every loop
+// a loop is its condition, body and increment, the initialization of a for loop is outside it
+class LoopTree {
+  public:
+    struct Loop {
+        // the loop it is in, -1 if it isn't in one
+        int parent = -1;
+        int functionID = 0;
+
+        // the loop's own, not multiplied by the loops it is in
+        float tripcount = 1;
+        float unrollFactor = 1;
+        bool pipelined = false;
+        int pipelinedType = 0;
+    };
+
+    void clear();
+
+    // by the ID given to the loop when parsing, in any order, before build
+    void addLoop(int loopID, int parentLoopID, const Loop &loop);
+
+    void build(const FlatGraph &graph);
+
+    int getNumLoops() const { return loops.size(); }
+    const std::vector<Loop> &getLoops() const { return loops; }
+
+    // the loop index of each node, in the order of the flat graph, -1 for nodes that were never written
+    const std::vector<int> &getNodeLoops() const { return nodeLoops; }
+
+    // the loop index of each BB, the innermost loop every node of the BB is in
+    const std::vector<int> &getBBLoops() const { return bbLoops; }
+
+  private:
+    std::vector<Loop> loops;
+    std::vector<int> depths;
+    std::vector<int> nodeLoops;
+    std::vector<int> bbLoops;
+
+    int getDepth(int loop);
+    int getCommonLoop(int loop1, int loop2);
+};
+
+} // namespace Balor
+
+#endif
@@ -1,4 +1,5 @@
 #include "node.h"
+#include "../designLimits.h"
 #include "args.h"
 #include <limits>
 
@@ -45,21 +46,33 @@ TypeStruct::TypeStruct(const std::string &stringIn) {
     }
 }
 
-GraphGenerator *Nodes::graphGenerator = nullptr;
-int Nodes::nodeID = 0;
+std::string getVariantName(NodeVariant variant) {
+    // in the order of NodeVariant
+    static const char *names[] = {"DEFAULT",         "EXTERNAL",     "LOCAL_ARRAY",        "EXTERNAL_ARRAY",
+                                  "PARAMETER_ARRAY", "LOCAL_SCALAR", "PARAMETER_SCALAR",   "CONSTANT",
+                                  "ALLOCA_INITIALIZER", "MEMORY",    "BRANCH",             "RETURN",
+                                  "CALL",            "STRUCT",       "COMPARISON",         "ARITHMETIC",
+                                  "GLOBAL_ARRAY"};
+    return names[int(variant)];
+}
+
+thread_local GraphGenerator *Nodes::graphGenerator = nullptr;
 
 void Nodes::setNodeID(Node *node) {
-    node->id = nodeID;
-    nodeID++;
+    node->id = graphGenerator->buildState.nodeID;
+    graphGenerator->buildState.nodeID++;
 }
 
-void Nodes::resetNodeID() { nodeID = 0; }
+void Nodes::resetNodeID() { graphGenerator->buildState.nodeID = 0; }
+
+void *Node::operator new(size_t size) { return Nodes::graphGenerator->arena->allocate(size); }
 
 Node::Node() {
-    // give to unique pointer to manage memory automatically
-    std::unique_ptr<Node> node_unique = std::unique_ptr<Node>(this);
-    // pass to vector on object so it passes out of scope at the right time
-    Nodes::graphGenerator->nodes_unq.push_back(std::move(node_unique));
+    // before it is added anywhere, so a design given up on here leaves nothing half made
+    Limits::check();
+
+    // the graph generator destroys it along with the graph
+    Nodes::graphGenerator->allocatedNodes.push_back(this);
 
     groupName = Nodes::graphGenerator->getGroupName();
     funcDec = Nodes::graphGenerator->getFuncDec();
@@ -67,23 +80,37 @@ Node::Node() {
     datasetIndex = Nodes::graphGenerator->datasetIndex;
     graphType = Nodes::graphGenerator->graphType;
 
-    pipelined = Nodes::graphGenerator->pragmaParser->getPipelined();
-    previouslyPipelined = Nodes::graphGenerator->pragmaParser->getPreviouslyPipelined();
+    pragmaEvent = Nodes::graphGenerator->pragmaParser->getNumEvents();
+    pragmaStateNode = Nodes::graphGenerator->stateNode;
+    applyPragmaState();
+
+    bbID = Nodes::graphGenerator->getBBID();
+    functionID = Nodes::graphGenerator->getFunctionID();
+    loopID = Nodes::graphGenerator->getLoopID();
+
+    // Add to raw pointer vector for actually use
+    Nodes::graphGenerator->nodes.push_back(this);
+}
+
+void Node::applyPragmaState() {
+    PragmaParser *pragmaParser = Nodes::graphGenerator->pragmaParser.get();
+
+    pipelined = pragmaParser->getPipelined();
+    previouslyPipelined = pragmaParser->getPreviouslyPipelined();
     
     if (pipelined){
-        pipelinedType = Nodes::graphGenerator->pragmaParser->getPipelinedType();
+        pipelinedType = pragmaParser->getPipelinedType();
     } else{
         pipelinedType = PipelinedType::NOT;
     }
 
 
-    tile = Nodes::graphGenerator->pragmaParser->getTile();
+    tile = pragmaParser->getTile();
 
-    unrollFactor = Nodes::graphGenerator->pragmaParser->getUnrollFactor();
+    unrollFactor = pragmaParser->getUnrollFactor();
 
     if(Nodes::graphGenerator->checkArg(PIPELINE_UNROLL)){
         if(previouslyPipelined && pipelinedType == PipelinedType::FINE){
-            PragmaParser *pragmaParser = Nodes::graphGenerator->pragmaParser.get();
             // first mark the unroll factor as the full tripcount
             StackedFactor extraUnroll = pragmaParser->getTripcount();
             // unrollFactor = pragmaParser->getTripcount();
@@ -110,13 +137,14 @@ Node::Node() {
         }
     }
 
-    tripcount = Nodes::graphGenerator->pragmaParser->getTripcount();
+    tripcount = pragmaParser->getTripcount();
 
-    bbID = Nodes::graphGenerator->getBBID();
-    functionID = Nodes::graphGenerator->getFunctionID();
+    unrollFactor.full *= unrollScale;
+}
 
-    // Add to raw pointer vector for actually use
-    Nodes::graphGenerator->nodes.push_back(this);
+void Node::scaleUnrollFactor(int scale) {
+    unrollScale *= scale;
+    unrollFactor.full *= scale;
 }
 
 std::string Node::getTypeToPrint() {
@@ -571,9 +599,7 @@ void ExternalNode::print() {
         printer.print();
 
         // push the external node closer to the top of the graph
-        std::cout << "subgraph cluster_External {" << std::endl;
-        std::cout << "{rank=min; node" + std::to_string(id) + "}" << std::endl;
-        std::cout << "}" << std::endl;
+        Nodes::graphGenerator->flatGraph.addTopOfGroup("External", id);
     }
 }
 
@@ -869,6 +895,19 @@ void FNegNode::print() {
     printer.print();
 }
 
+void LocalScalarNode::saveBuiltState() {
+    Node::saveBuiltState();
+    builtIteratorState = {fixedSizeIterator, hasIteratorInit, writtenToAsIterator, bounds};
+}
+
+void LocalScalarNode::restoreBuiltState() {
+    Node::restoreBuiltState();
+    fixedSizeIterator = builtIteratorState.fixedSizeIterator;
+    hasIteratorInit = builtIteratorState.hasIteratorInit;
+    writtenToAsIterator = builtIteratorState.writtenToAsIterator;
+    bounds = builtIteratorState.bounds;
+}
+
 void LocalScalarNode::addBound(Node *bound) {
     if (inIteratorBoundsRegion) {
         if (ConstantNode *constant = dynamic_cast<ConstantNode *>(bound)) {
@@ -40,6 +40,9 @@ enum class NodeVariant {
     GLOBAL_ARRAY
 };
 
+// the name of a variant, e.g. LOCAL_ARRAY
+std::string getVariantName(NodeVariant variant);
+
 enum class DataType { INTEGER, FLOAT, STRUCT};
 
 class TypeStruct {
@@ -87,18 +90,23 @@ struct StackedFactor {
 //       Base Types to Inherit From
 //-------------------------------------------
 
+// node IDs are counted in the build state of the current graph
 class Nodes {
   public:
-    static GraphGenerator *graphGenerator;
+    // the graph being built on this thread, see GraphGenerator::CurrentGraph
+    static thread_local GraphGenerator *graphGenerator;
     static void setNodeID(Node *node);
     static void resetNodeID();
-
-  private:
-    static int nodeID;
 };
 
 class Node {
   public:
+    virtual ~Node() = default;
+
+    // nodes are made in the arena of the graph being generated, which destroys them
+    static void *operator new(size_t size);
+    static void operator delete(void *memory) {}
+
     virtual void print() = 0;
     virtual TypeStruct getType() { throw std::runtime_error("Type was pulled from node without type"); }
 
@@ -136,6 +144,8 @@ class Node {
 
     int bbID;
     int functionID;
+    // the innermost loop the node is in, 0 if it isn't in one
+    int loopID;
 
     // number of array elements for array variables
     int numElements0 = 1;
@@ -160,9 +170,32 @@ class Node {
 
     virtual NodeVariant getVariant() { return NodeVariant::DEFAULT; }
 
+    // pragma state when the node was made:
+    // how many pragma events had been parsed, and the state node
+    int pragmaEvent = 0;
+    Node *pragmaStateNode = nullptr;
+
+    // the variable whose array pragmas were applied to this node
+    std::string pragmaVariable;
+
+    // set the pragma fields from the current pragma state
+    void applyPragmaState();
+
+    // for nodes that stand in for several operations, e.g. an array initialization
+    void scaleUnrollFactor(int scale);
+
+    // printing can change a node, e.g. iterator bitwidth reduction
+    // so the state after parsing is kept to print the graph again
+    virtual void saveBuiltState() { builtType = type; }
+    virtual void restoreBuiltState() { type = builtType; }
+
   protected:
     Node();
     TypeStruct type;
+
+  private:
+    TypeStruct builtType;
+    int unrollScale = 1;
 };
 
 //----------------------------------------
@@ -352,6 +385,18 @@ class LocalScalarNode : public Node {
     TypeStruct getType() override { return type; }
 
     NodeVariant getVariant() override { return NodeVariant::LOCAL_SCALAR; }
+
+    void saveBuiltState() override;
+    void restoreBuiltState() override;
+
+  private:
+    struct IteratorState {
+        bool fixedSizeIterator;
+        bool hasIteratorInit;
+        bool writtenToAsIterator;
+        std::vector<double> bounds;
+    };
+    IteratorState builtIteratorState;
 };
 
 class ParameterScalarNode : public Node {
@@ -616,6 +661,19 @@ class StructAccessNode : public DerefNode {
     void print() override;
 };
 
+// A loop of the loop nest, never written itself
+// made where the body starts, so its pragma state is the state of the loop's body:
+// the first unroll factor and tripcount are the loop's own
+class LoopNode : public Node {
+  public:
+    LoopNode(int loop, int parentLoop) : loop(loop), parentLoop(parentLoop) {}
+    // the ID of the loop, and of the loop it is in, 0 if it isn't in one
+    int loop;
+    int parentLoop;
+
+    void print() override {}
+};
+
 } // namespace Balor
 
 #endif
\ No newline at end of file
@@ -55,10 +55,6 @@ std::string addPragmaToLabel(Balor::Node *node, std::string label) {
     return label;
 }
 
-void output(std::string message) { 
-    std::cout << message << std::endl; 
-}
-
 std::string toVariableType(Balor::Node *node) {
     Balor::TypeStruct type;
     try{
@@ -169,10 +165,6 @@ NodePrinter::NodePrinter(Node *node, const std::string &color) : color(color) {
 }
 
 void NodePrinter::print() {
-    std::string out = "node" + std::to_string(node->id);
-    out += " [";
-    out += "style=filled fillcolor=\"" + color + "\" ";
-
     if (Nodes::graphGenerator->checkArg(ABSORB_PRAGMAS)) {
         attributes["label"] = addPragmaToLabel(node, attributes["label"]);
     }
@@ -231,13 +223,7 @@ void NodePrinter::print() {
 
     // attributes["label"] += "\n " + node->datasetIndex;
 
-    for (std::pair<std::string, std::string> attribute : attributes) {
-        out += attribute.first;
-        out += "=\"";
-        out += attribute.second;
-        out += "\" ";
-    }
-    out += "]";
-    output(out);
+    Nodes::graphGenerator->flatGraph.addNode(node->id, node->bbID, node->loopID, color, attributes);
+    Nodes::graphGenerator->buildState.printedNodes[node->id] = node;
 }
 } // namespace Balor
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "pragmaParser.h"
+#include "../utility.h"
 #include "rose.h"
 
 #include <boost/algorithm/string.hpp>
@@ -7,26 +8,48 @@ namespace Balor {
 
 void PragmaParser::parseInlinePragmas(std::set<SgFunctionDeclaration *> funcDecs) {
     for(SgFunctionDeclaration *funcDec : funcDecs){
-        if (parseInlinePragma(funcDec)) {
+        bool inlined = readInlinePragma(funcDec);
+        logEvent(PragmaEventType::FUNCTION_INLINE, nullptr, funcDec, inlined);
+
+        if (inlined) {
             inlinedFunctions.push(funcDec);
         }
     }
 }
 
 bool PragmaParser::parseInlinePragma(SgFunctionDeclaration *funcDec) {
+    bool inlined = readInlinePragma(funcDec);
+    logEvent(PragmaEventType::CALL_INLINE, nullptr, funcDec, inlined);
+
+    return inlined;
+}
+
+bool PragmaParser::readInlinePragma(SgFunctionDeclaration *funcDec) {
     if (funcDec->get_definition()) {
         SgBasicBlock *bb = funcDec->get_definition()->get_body();
 
         functionInlined = false;
-        parsePragmas(bb);
+        readPragmas(bb);
 
         return functionInlined;
     }
     return false;
 }
 
+void PragmaParser::registerCall(SgFunctionDeclaration *funcDec) {
+    logEvent(PragmaEventType::REGISTER_CALL, nullptr, funcDec, false);
+
+    graphGenerator->registerCalls(funcDec, getUnrollFactor().full);
+}
+
 void PragmaParser::parsePragmas(SgBasicBlock *bb) {
-    std::vector<SgNode *> pragmas = NodeQuery::querySubTree(bb, V_SgPragmaDeclaration, AstQueryNamespace::ChildrenOnly);
+    logEvent(PragmaEventType::PARSE, bb, nullptr, false);
+
+    readPragmas(bb);
+}
+
+void PragmaParser::readPragmas(SgBasicBlock *bb) {
+    std::vector<SgNode *> pragmas = querySubTree(bb, V_SgPragmaDeclaration, AstQueryNamespace::ChildrenOnly);
 
     int unrollFactor = 1;
     float tripcount = 1;
@@ -204,6 +227,8 @@ void PragmaParser::parsePragmas(SgBasicBlock *bb) {
 }
 
 void PragmaParser::unstackPragmas() {
+    logEvent(PragmaEventType::UNSTACK, nullptr, nullptr, false);
+
     unrollHierarchy.moveUp();
     tripcountHierarchy.moveUp();
     tileHierarchy.moveUp();
@@ -216,21 +241,25 @@ void PragmaParser::unstackPragmas() {
 }
 
 void PragmaParser::enterLoopCondition() {
+    logEvent(PragmaEventType::ENTER_LOOP_CONDITION, nullptr, nullptr, false);
     unrollHierarchy.pauseFactor();
     tripcountHierarchy.pauseFactor();
     tileHierarchy.pauseFactor();
 }
 void PragmaParser::exitLoopCondition() {
+    logEvent(PragmaEventType::EXIT_LOOP_CONDITION, nullptr, nullptr, false);
     unrollHierarchy.unpauseFactor();
     tripcountHierarchy.unpauseFactor();
     tileHierarchy.unpauseFactor();
 }
 
 void PragmaParser::enterLoopInc() {
+    logEvent(PragmaEventType::ENTER_LOOP_INC, nullptr, nullptr, false);
     unrollHierarchy.pauseFactor();
     tileHierarchy.pauseFactor();
 }
 void PragmaParser::exitLoopInc() {
+    logEvent(PragmaEventType::EXIT_LOOP_INC, nullptr, nullptr, false);
     unrollHierarchy.unpauseFactor();
     tileHierarchy.unpauseFactor();
 }
@@ -279,5 +308,73 @@ PipelinedType PragmaParser::getPipelinedType(){
     return currentPipelinedType;
 }
 
+void PragmaParser::logEvent(PragmaEventType type, SgBasicBlock *bb, SgFunctionDeclaration *funcDec, bool inlined) {
+    if (replaying) {
+        return;
+    }
+
+    PragmaEvent event;
+    event.type = type;
+    event.bb = bb;
+    event.funcDec = funcDec;
+    event.stateNode = graphGenerator->stateNode;
+    event.inlined = inlined;
+    events.push_back(event);
+}
+
+void PragmaParser::reset() {
+    unrollHierarchy = FactorHierarchy();
+    tripcountHierarchy = FactorHierarchy();
+    tileHierarchy = FactorHierarchy();
+
+    previouslyPipelined = false;
+    pipelineTripcount = 1;
+
+    pipelineStack = std::stack<bool>();
+    currentPipelinedType = PipelinedType::NOT;
+
+    functionInlined = false;
+    inlinedFunctions = std::queue<SgFunctionDeclaration *>();
+}
+
+bool PragmaParser::replayEvent(const PragmaEvent &event) {
+    bool replayed = true;
+
+    replaying = true;
+    switch (event.type) {
+    case PragmaEventType::PARSE:
+        parsePragmas(event.bb);
+        break;
+    case PragmaEventType::UNSTACK:
+        unstackPragmas();
+        break;
+    case PragmaEventType::ENTER_LOOP_CONDITION:
+        enterLoopCondition();
+        break;
+    case PragmaEventType::EXIT_LOOP_CONDITION:
+        exitLoopCondition();
+        break;
+    case PragmaEventType::ENTER_LOOP_INC:
+        enterLoopInc();
+        break;
+    case PragmaEventType::EXIT_LOOP_INC:
+        exitLoopInc();
+        break;
+    case PragmaEventType::CALL_INLINE:
+        replayed = parseInlinePragma(event.funcDec) == event.inlined;
+        break;
+    case PragmaEventType::FUNCTION_INLINE:
+        parseInlinePragmas({event.funcDec});
+        break;
+    case PragmaEventType::REGISTER_CALL:
+        graphGenerator->stateNode = event.stateNode;
+        registerCall(event.funcDec);
+        break;
+    }
+    replaying = false;
+
+    return replayed;
+}
+
 } // namespace Balor
 
@@ -11,6 +11,7 @@
 
 namespace Balor {
 class GraphGenerator;
+class Node;
 
 struct StackedFactor;
 
@@ -74,6 +75,31 @@ enum class PipelinedType {
     FINE
 };
 
+enum class PragmaEventType {
+    PARSE,
+    UNSTACK,
+    ENTER_LOOP_CONDITION,
+    EXIT_LOOP_CONDITION,
+    ENTER_LOOP_INC,
+    EXIT_LOOP_INC,
+    // inline pragma checked at a call site, decides if the call is inlined on the graph
+    CALL_INLINE,
+    // inline pragma checked after parsing, only marks the function as inlined
+    FUNCTION_INLINE,
+    REGISTER_CALL
+};
+
+// Everything that changes the pragma state while parsing is logged,
+// so the same loop nest can be walked again with different pragma text
+// without walking the AST
+struct PragmaEvent {
+    PragmaEventType type;
+    SgBasicBlock *bb = nullptr;
+    SgFunctionDeclaration *funcDec = nullptr;
+    Node *stateNode = nullptr;
+    bool inlined = false;
+};
+
 
 class PragmaParser {
   public:
@@ -86,6 +112,9 @@ class PragmaParser {
     void parseInlinePragmas(std::set<SgFunctionDeclaration *> funcDecs);
     bool parseInlinePragma(SgFunctionDeclaration *funcDec);
 
+    // register an inlined call with the current unroll factor
+    void registerCall(SgFunctionDeclaration *funcDec);
+
     void stackPragmas();
     void unstackPragmas();
 
@@ -110,20 +139,38 @@ class PragmaParser {
     bool functionInlined = false;
     std::queue<SgFunctionDeclaration *> inlinedFunctions;
 
+    int getNumEvents() { return events.size(); }
+    // drop events logged after the graph was built, e.g. by printing
+    void truncateEvents(int numEvents) { events.resize(numEvents); }
+    const std::vector<PragmaEvent> &getEvents() { return events; }
+
+    // go back to the state before parsing, keeping the event log
+    void reset();
+
+    // apply a logged event to the pragma state
+    // returns false if a call site would be inlined differently,
+    // which changes the graph and can't be replayed
+    bool replayEvent(const PragmaEvent &event);
+
   private:
+    void readPragmas(SgBasicBlock *bb);
+    bool readInlinePragma(SgFunctionDeclaration *funcDec);
+    void logEvent(PragmaEventType type, SgBasicBlock *bb, SgFunctionDeclaration *funcDec, bool inlined);
+
+    std::vector<PragmaEvent> events;
+    bool replaying = false;
+
     std::map<std::string, std::string> variableToPortType;
 
     FactorHierarchy unrollHierarchy;
     FactorHierarchy tripcountHierarchy;
     FactorHierarchy tileHierarchy;
 
-    bool previouslyPipelined;
-    float pipelineTripcount;
-
-    PipelinedType pipelinedType;
+    bool previouslyPipelined = false;
+    float pipelineTripcount = 1;
 
     std::stack<bool> pipelineStack;
-    PipelinedType currentPipelinedType;
+    PipelinedType currentPipelinedType = PipelinedType::NOT;
 };
 
 } // namespace Balor
@@ -1,6 +1,7 @@
 
 
 #include "variableMapper.h"
+#include "../utility.h"
 
 namespace Balor {
 
@@ -60,19 +61,42 @@ void setNumElements(Node* node, SgArrayType* arrayType) {
 }
 
 void VariableMapper::addArrayPragmas(const std::string &variableName, Node *pointerNode) {
+    pointerNode->pragmaVariable = variableName;
+    applyArrayPragmas(variableName, pointerNode, true);
+}
+
+void VariableMapper::reapplyArrayPragmas(Node *pointerNode) {
+    pointerNode->resourceType = "none";
+    pointerNode->partitionFactor1 = 0;
+    pointerNode->partitionFactor2 = 0;
+    pointerNode->partitionFactor3 = 0;
+    pointerNode->partitionType1 = "none";
+    pointerNode->partitionType2 = "none";
+    pointerNode->partitionType3 = "none";
+
+    applyArrayPragmas(pointerNode->pragmaVariable, pointerNode, false);
+}
+
+void VariableMapper::applyArrayPragmas(const std::string &variableName, Node *pointerNode, bool addPragmaNodes) {
     if (resourceTypeMap.count(variableName)) {
-        PragmaNode *pragma;
+        PragmaNode *pragma = nullptr;
         if (resourceTypeMap[variableName] == "RAM_2P_BRAM") {
-            pragma = new Bram2P_ResourceAllocationPragmaNode();
+            if (addPragmaNodes) {
+                pragma = new Bram2P_ResourceAllocationPragmaNode();
+            }
             pointerNode->resourceType = "bram_2P";
         } else if (resourceTypeMap[variableName] == "RAM_1P_BRAM"){
-            pragma = new Bram1P_ResourceAllocationPragmaNode();
+            if (addPragmaNodes) {
+                pragma = new Bram1P_ResourceAllocationPragmaNode();
+            }
             pointerNode->resourceType = "bram_1P";
         } else {
             throw std::runtime_error("Unknown resource binding: " + resourceTypeMap[variableName]);
         }
 
-        new ResourceAllocationPragmaEdge(pragma, pointerNode);
+        if (addPragmaNodes) {
+            new ResourceAllocationPragmaEdge(pragma, pointerNode);
+        }
     }
 
     if (arrayPartitionMap.count(variableName)) {
@@ -87,7 +111,10 @@ void VariableMapper::addArrayPragmas(const std::string &variableName, Node *poin
             int factor = std::get<1>(partitionData);
             int dim = std::get<2>(partitionData);
 
-            PragmaNode *pragma = new ArrayPartitionPragmaNode(type, factor, dim);
+            PragmaNode *pragma = nullptr;
+            if (addPragmaNodes) {
+                pragma = new ArrayPartitionPragmaNode(type, factor, dim);
+            }
             if (type == "complete") {
                 if(dim == 1){
                     pointerNode->partitionFactor1 = 1;
@@ -116,7 +143,9 @@ void VariableMapper::addArrayPragmas(const std::string &variableName, Node *poin
                 throw std::runtime_error("Unrecognized partition type: " + type);
             }
 
-            new ArrayPartitionPragmaEdge(pragma, pointerNode);
+            if (addPragmaNodes) {
+                new ArrayPartitionPragmaEdge(pragma, pointerNode);
+            }
         }
     }
 }
@@ -140,8 +169,8 @@ Node *VariableMapper::createLocalVariableNode(SgInitializedName *variable) {
 
         SgType *elementType = arrayType->get_base_type()->findBaseType();
 
-        TypeStruct arrayTypeDesc = TypeStruct(elementType->unparseToString());
-        arrayTypeDesc.overrideType(variable->get_type()->unparseToString());
+        TypeStruct arrayTypeDesc = TypeStruct(unparse(elementType));
+        arrayTypeDesc.overrideType(unparse(variable->get_type()));
         LocalArrayNode *node = new LocalArrayNode(variable->get_name(), arrayTypeDesc);
 
 
@@ -157,14 +186,14 @@ Node *VariableMapper::createLocalVariableNode(SgInitializedName *variable) {
                 setNumElements(node, arrayType);
             }
         }
-        node->setType(elementType->unparseToString());
+        node->setType(unparse(elementType));
         return node;
     } else {
         std::string description = variable->get_name();
         Node *node = new LocalScalarNode(description);
         variableToReadNode[variable] = node;
         variableToWriteNode[variable] = node;
-        node->setType(variableType->findBaseType()->unparseToString());
+        node->setType(unparse(variableType->findBaseType()));
         return node;
     }
 }
@@ -198,8 +227,8 @@ Node *VariableMapper::createParameterVariableNode(SgInitializedName *variable) {
         if (!finishedMain) {
             // pass the real type so that
             // if not one-hot-encoding the type we can get int/float and bitwidth
-            TypeStruct arrayTypeDesc = TypeStruct(elementType->unparseToString());
-            arrayTypeDesc.overrideType(variable->get_type()->unparseToString());
+            TypeStruct arrayTypeDesc = TypeStruct(unparse(elementType));
+            arrayTypeDesc.overrideType(unparse(variable->get_type()));
             node = new ExternalArrayNode(variableName, arrayTypeDesc);
         } else {
             // programl didn't string encode array type for parameters and so neither did I
@@ -218,7 +247,7 @@ Node *VariableMapper::createParameterVariableNode(SgInitializedName *variable) {
             if(arrayType){
                 setNumElements(node, arrayType);
             }
-            node->setType(elementType->unparseToString());
+            node->setType(unparse(elementType));
         }
 
         return node;
@@ -234,7 +263,7 @@ Node *VariableMapper::createParameterVariableNode(SgInitializedName *variable) {
         ParameterScalarNode *parameterScalar = new ParameterScalarNode(variableName);
         variableToReadNode[variable] = parameterScalar;
         variableToWriteNode[variable] = parameterScalar;
-        parameterScalar->setType(variableType->findBaseType()->unparseToString());
+        parameterScalar->setType(unparse(variableType->findBaseType()));
         return parameterScalar;
     }
 }
@@ -296,17 +325,17 @@ Node *VariableMapper::readVariable(SgInitializedName *variable) {
 
         // but they would be quick to implement with an example
         SgType *variableType = variable->get_type();
-        size_t isConst = variableType->unparseToString().find("const");
+        size_t isConst = unparse(variableType).find("const");
         if (isConst != std::string::npos) {
             if (variableType->variantT() == V_SgArrayType || variableType->variantT() == V_SgPointerType) {
                 TypeStruct typeDesc = TypeStruct();
-                typeDesc.overrideType(variable->get_type()->unparseToString());
+                typeDesc.overrideType(unparse(variable->get_type()));
 
                 // SgArrayType *arrayType = isSgArrayType(variableType);
                 SgType *elementType = variableType->findBaseType();
 
-                TypeStruct elementTypeDesc = TypeStruct(elementType->unparseToString());
-                Node *constant = new GlobalArrayNode(variable->unparseToString(), elementTypeDesc, typeDesc);
+                TypeStruct elementTypeDesc = TypeStruct(unparse(elementType));
+                Node *constant = new GlobalArrayNode(unparse(variable), elementTypeDesc, typeDesc);
                 variableToReadNode[variable] = constant;
                 nonReadVariables.insert(constant);
                 return constant;
@@ -344,13 +373,13 @@ void VariableMapper::addStructTypeToMap(SgType *structType) {
                     if (varDec->get_type()->variantT() == V_SgArrayType) {
                         // keep array type names in full
                         TypeStruct arrayType = TypeStruct();
-                        arrayType.overrideType(varDec->get_type()->unparseToString());
+                        arrayType.overrideType(unparse(varDec->get_type()));
 
                         structField = new StructArrayFieldNode(index, arrayType);
                     } else {
                         structField = new StructFieldNode(index);
                     }
-                    structField->setType(varDec->get_type()->findBaseType()->unparseToString());
+                    structField->setType(unparse(varDec->get_type()->findBaseType()));
 
                     fieldsToFieldNodeMap[varDec] = structField;
                     index++;
@@ -48,10 +48,17 @@ class VariableMapper {
 
     void addArrayPragmas(const std::string &variableName, Node *pointerNode);
 
+    // set the partition and resource fields again from the current pragma maps,
+    // without adding pragma nodes
+    void reapplyArrayPragmas(Node *pointerNode);
+
     void addStructTypeToMap(SgType *structType);
     StructFieldNode *getStructField(SgType *structType, SgInitializedName *variable);
 
     bool finishedMain = false;
+
+  private:
+    void applyArrayPragmas(const std::string &variableName, Node *pointerNode, bool addPragmaNodes);
 };
 } // namespace Balor
 
@@ -1,71 +1,255 @@
 #include <algorithm>
+#include <fstream>
 #include <functional>
 #include <numeric>
+#include <sstream>
 
+#include "batch.h"
+#include "cache.h"
 #include "commandLine.h"
+#include "drive.h"
+#include "profile.h"
+#include "serve.h"
 #include "utility.h"
 #include "graph/args.h"
 #include "graph/graphGenerator.h"
+#include "graph/graphStats.h"
 #include "rose.h"
+#include <boost/algorithm/string.hpp>
+
+namespace {
+
+// Write the graph in each of its formats, as extension and contents, to files named after it or cout
+int writeGraphs(Sawyer::CommandLine::ParserResult parserResult, const std::string &name,
+                const std::vector<std::pair<std::string, std::string>> &graphs) {
+    bool makePdf = parserResult.have(Balor::MAKE_PDF);
+    bool makeDot = parserResult.have(Balor::MAKE_DOT);
+
+    if (!makePdf && !makeDot) {
+        std::cout << graphs.front().second << std::flush;
+        return 0;
+    }
+
+    std::string outputFolder = Balor::CommandLine::getOutputsFolder(parserResult);
+    std::string fileName = outputFolder + name;
+
+    for (auto &graph : graphs) {
+        std::ofstream out(fileName + graph.first, std::ios::binary);
+        out << graph.second;
+    }
+
+    if (makePdf) {
+        std::string reorderCall = "python scripts/reorderNodes.py " + fileName + ".dot " + fileName + "_reordered.dot";
+        system(reorderCall.c_str());
+
+        std::string dotCall = "dot -Tpdf " + fileName + "_reordered.dot -o " + fileName + ".pdf";
+        system(dotCall.c_str());
+    }
+    return 0;
+}
+
+// the files of a config's graph are named after the top level function and the config
+std::string getGraphName(const std::string &topLevelFunctionName, const Balor::GraphConfig &config) {
+    return config.name.empty() ? topLevelFunctionName : topLevelFunctionName + "." + config.name;
+}
+
+} // namespace
 
 int main(int argc, char *argv[]) {
+    Balor::Profile::Clock::time_point initializeBegin = Balor::Profile::Clock::now();
     // Initialize and check compatibility. See Rose::initialize
     ROSE_INITIALIZE;
+    Balor::Profile::Clock::time_point initializeEnd = Balor::Profile::Clock::now();
 
     Sawyer::CommandLine::ParserResult parserResult = Balor::CommandLine::parseCommandLine(argc, argv);
 
+    // written when the program exits, however it does
+    std::string profileFile = Balor::CommandLine::getProfileFile(parserResult);
+    if (!profileFile.empty()) {
+        Balor::Profile::start(profileFile);
+        Balor::Profile::addPhase("ROSE_INITIALIZE", initializeBegin, initializeEnd);
+    }
+
+    // the source files come with each request
+    if (parserResult.have("serve")) {
+        return Balor::Serve::runServer(parserResult);
+    }
+
+    // every kernel comes from the jobs file
+    if (parserResult.have("drive")) {
+        try {
+            int failures = Balor::Drive::runDriver(parserResult);
+            return failures ? 1 : 0;
+        } catch (std::invalid_argument e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+    }
+
     std::vector<std::string> frontendArgs;
     std::string topLevelFunctionName;
 
     SgProject *project;
     SgFunctionDefinition *topLevelFunctionDef;
 
+    std::string batchManifest = Balor::CommandLine::getBatchManifest(parserResult);
+
+    std::vector<std::string> vitisDirectives;
+
+    // without --configs one graph, with the switches of the command line
+    std::vector<Balor::GraphConfig> configs;
+    bool namedConfigs = false;
+
+    std::unique_ptr<Balor::Cache::GraphCache> graphCache;
+    std::vector<std::string> cacheInputs;
+
+    // the graph of each config in each output format, as extension and contents
+    std::vector<std::vector<std::pair<std::string, std::string>>> graphs;
+
     try {
         frontendArgs = Balor::CommandLine::getFrontendArgs(parserResult);
+        topLevelFunctionName = Balor::CommandLine::getTopLevelFunctionName(parserResult);
+
+        // check early, before anything is generated
+        std::vector<std::string> formats = Balor::CommandLine::getOutputFormats(parserResult);
+        Balor::CommandLine::getMaxNodes(parserResult);
+        bool writesFiles = parserResult.have(Balor::MAKE_PDF) || parserResult.have(Balor::MAKE_DOT);
+        if (parserResult.have(Balor::MAKE_PDF) && std::find(formats.begin(), formats.end(), "dot") == formats.end()) {
+            throw std::invalid_argument("A pdf can only be made from the dot format");
+        }
+        if (!writesFiles && batchManifest.empty() && formats.size() > 1) {
+            throw std::invalid_argument("Only one output format can be printed to cout, use --make_dot to write several");
+        }
+
+        configs = Balor::CommandLine::getGraphConfigs(parserResult);
+        namedConfigs = !configs.empty();
+        if (!namedConfigs) {
+            configs.push_back(Balor::GraphConfig());
+        }
+        if ((!writesFiles || parserResult.have("stats")) && batchManifest.empty() && configs.size() > 1) {
+            throw std::invalid_argument(
+                "Only one config can be printed to cout, use --make_dot to write a file per config");
+        }
+
+        std::string vitisDirectivesFile = Balor::CommandLine::getVitisDirectivesFile(parserResult);
+        if (!vitisDirectivesFile.empty()) {
+            vitisDirectives = Balor::Batch::readVitisDirectives(vitisDirectivesFile);
+        }
+
+        // a graph made before from the same inputs is output without parsing the source
+        // only graphs are cached, not their stats
+        if (!parserResult.have("stats")) {
+            graphCache = Balor::Cache::makeGraphCache(parserResult);
+        }
+        if (graphCache && batchManifest.empty()) {
+            Balor::Batch::Design design;
+            design.datasetIndex = parserResult.parsed("datasetIndex").back().asString();
+            design.graphType = parserResult.parsed("graphType").back().asString();
+            design.vitisDirectives = vitisDirectives;
+            std::string sourceDescription = Balor::Cache::describeSource(parserResult);
+
+            size_t numCached = 0;
+            for (const Balor::GraphConfig &config : configs) {
+                cacheInputs.push_back(Balor::Cache::describeInputs(sourceDescription, parserResult, design,
+                                                                   namedConfigs ? &config : nullptr));
+
+                graphs.emplace_back();
+                for (const std::string &format : formats) {
+                    std::string extension = Balor::makeGraphWriter(format)->getExtension();
+                    std::string graph;
+                    if (graphCache->lookup(cacheInputs.back(), extension, graph)) {
+                        graphs.back().push_back(std::make_pair(extension, graph));
+                        numCached++;
+                    }
+                }
+            }
+            if (numCached == configs.size() * formats.size()) {
+                for (size_t config = 0; config < configs.size(); config++) {
+                    writeGraphs(parserResult, getGraphName(topLevelFunctionName, configs[config]), graphs[config]);
+                }
+                return 0;
+            }
+            graphs.clear();
+        }
 
         // Build the AST used by ROSE
-        project = frontend(frontendArgs);
+        {
+            Balor::Profile::Phase phase("frontend");
+            project = frontend(frontendArgs);
+        }
         ROSE_ASSERT(project != NULL);
 
         SgGlobal *globalScope = SageInterface::getFirstGlobalScope(project);
         SageBuilder::pushScopeStack(isSgScopeStatement(globalScope));
 
-        topLevelFunctionName = Balor::CommandLine::getTopLevelFunctionName(parserResult);
-        topLevelFunctionDef = Balor::getTopLevelFunctionDef(project, topLevelFunctionName);
+        {
+            Balor::Profile::Phase phase("getTopLevelFunctionDef");
+            topLevelFunctionDef = Balor::getTopLevelFunctionDef(project, topLevelFunctionName);
+        }
+
+        // each design of a batch inserts them along with its own
+        if (batchManifest.empty() && !vitisDirectives.empty()) {
+            Balor::Batch::DirectiveApplier(project).applyVitisDirectives(vitisDirectives);
+        }
     } catch (std::invalid_argument e) {
         std::cout << e.what() << std::endl;
         return 1;
     }
 
-    bool makePdf = parserResult.have(Balor::MAKE_PDF);
-    bool makeDot = parserResult.have(Balor::MAKE_DOT);
+    // one frontend parse, many designs
+    if (!batchManifest.empty()) {
+        try {
+            int failures = Balor::Batch::runBatch(parserResult, project, topLevelFunctionDef);
+            return failures ? 1 : 0;
+        } catch (std::invalid_argument e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+    }
 
-    std::string outputFolder = Balor::CommandLine::getOutputsFolder(parserResult);
+    // every config is generated from the one parse
+    for (size_t config = 0; config < configs.size(); config++) {
+        Balor::GraphGenerator graphGen(parserResult, nullptr, namedConfigs ? &configs[config] : nullptr);
+        graphGen.generateGraph(topLevelFunctionDef);
 
-    Balor::GraphGenerator graphGen = Balor::GraphGenerator(parserResult);
-    graphGen.generateGraph(topLevelFunctionDef);
+        if (graphGen.checkArg(Balor::COMPACT)) {
+            // cout may be the graph
+            const Balor::CompactionStats &stats = graphGen.compactionStats;
+            std::cerr << "Compaction removed " << stats.nodesRemoved << " nodes and " << stats.edgesRemoved
+                      << " edges (" << stats.constantsMerged << " constants merged, " << stats.controlNodesCollapsed
+                      << " control flow nodes skipped)" << std::endl;
+        }
 
-    if (makePdf || makeDot) {
-        std::string fileName = outputFolder + topLevelFunctionName;
+        if (!graphGen.appliedReductions.empty()) {
+            std::cerr << "Turned on " << boost::algorithm::join(graphGen.appliedReductions, ", ") << " to fit in "
+                      << Balor::CommandLine::getMaxNodes(parserResult) << " nodes, the graph has "
+                      << graphGen.flatGraph.getNumNodes() << std::endl;
+        }
 
-        std::ofstream out(fileName + ".dot");
-        std::streambuf *coutbuf = std::cout.rdbuf(); // save old buf
-        std::cout.rdbuf(out.rdbuf());                // redirect std::cout
+        // the counts instead of the graph
+        if (parserResult.have("stats")) {
+            Balor::writeGraphStats(graphGen, std::cout);
+            continue;
+        }
 
-        graphGen.printGraph();
+        // the graph is built once, and written in each format
+        std::vector<std::pair<std::string, std::string>> configGraphs;
+        for (auto &graphWriter : graphGen.graphWriters) {
+            std::ostringstream graph;
+            std::streambuf *coutbuf = std::cout.rdbuf(); // save old buf
+            std::cout.rdbuf(graph.rdbuf());              // redirect std::cout
 
-        std::cout.rdbuf(coutbuf); // restore cout
+            graphGen.printGraph(*graphWriter);
 
-        if (makePdf) {
-            std::string reorderCall =
-                "python scripts/reorderNodes.py " + fileName + ".dot " + fileName + "_reordered.dot";
-            system(reorderCall.c_str());
+            std::cout.rdbuf(coutbuf); // restore cout
 
-            std::string dotCall = "dot -Tpdf " + fileName + "_reordered.dot -o " + fileName + ".pdf";
-            system(dotCall.c_str());
+            configGraphs.push_back(std::make_pair(graphWriter->getExtension(), graph.str()));
+            if (graphCache) {
+                graphCache->store(cacheInputs[config], configGraphs.back().first, configGraphs.back().second);
+            }
         }
-    } else {
-        graphGen.printGraph();
+
+        writeGraphs(parserResult, getGraphName(topLevelFunctionName, configs[config]), configGraphs);
     }
 
     return 0;
@@ -0,0 +1,187 @@
+#include "profile.h"
+#include "designLimits.h"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace {
+
+struct PhaseTotal {
+    double seconds = 0;
+    long calls = 0;
+    long rssGrowthKB = 0;
+    long peakRssGrowthKB = 0;
+};
+
+struct Profiler {
+    std::string outputFile;
+
+    std::mutex mutex;
+    std::vector<std::string> phaseOrder;
+    std::map<std::string, PhaseTotal> phases;
+    std::map<std::string, long> counts;
+};
+
+std::atomic<bool> enabled(false);
+std::atomic<long> unparseCalls(0);
+std::atomic<long> queryCalls(0);
+
+Profiler &getProfiler() {
+    static Profiler profiler;
+    return profiler;
+}
+
+// kilobytes on linux
+long getPeakRssKB() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return usage.ru_maxrss;
+}
+
+void writeAtExit() { Balor::Profile::write(); }
+
+} // namespace
+
+namespace Balor {
+namespace Profile {
+
+void start(const std::string &outputFile) {
+    Profiler &profiler = getProfiler();
+    profiler.outputFile = outputFile;
+
+    if (!enabled.exchange(true)) {
+        // the profiler was made before this, so it is still there when this runs
+        std::atexit(writeAtExit);
+    }
+}
+
+bool isEnabled() { return enabled; }
+
+const std::string &getOutputFile() { return getProfiler().outputFile; }
+
+void restart(const std::string &outputFile) {
+    Profiler &profiler = getProfiler();
+    std::lock_guard<std::mutex> lock(profiler.mutex);
+
+    profiler.outputFile = outputFile;
+    profiler.phaseOrder.clear();
+    profiler.phases.clear();
+    profiler.counts.clear();
+    unparseCalls = 0;
+    queryCalls = 0;
+}
+
+void addPhase(const std::string &name, Clock::time_point begin, Clock::time_point end, long beginRssKB,
+              long beginPeakRssKB) {
+    if (!enabled) {
+        return;
+    }
+    long endRssKB = Balor::Limits::getRssKB();
+    long endPeakRssKB = getPeakRssKB();
+
+    Profiler &profiler = getProfiler();
+    std::lock_guard<std::mutex> lock(profiler.mutex);
+
+    if (!profiler.phases.count(name)) {
+        profiler.phaseOrder.push_back(name);
+    }
+    PhaseTotal &phase = profiler.phases[name];
+    phase.seconds += std::chrono::duration<double>(end - begin).count();
+    phase.calls++;
+    phase.rssGrowthKB = std::max(phase.rssGrowthKB, endRssKB - beginRssKB);
+    phase.peakRssGrowthKB += endPeakRssKB - beginPeakRssKB;
+}
+
+void count(const std::string &name, long amount) {
+    if (!enabled) {
+        return;
+    }
+
+    Profiler &profiler = getProfiler();
+    std::lock_guard<std::mutex> lock(profiler.mutex);
+    profiler.counts[name] += amount;
+}
+
+void countUnparse() {
+    if (enabled) {
+        unparseCalls++;
+    }
+}
+
+void countQuery() {
+    if (enabled) {
+        queryCalls++;
+    }
+}
+
+void write() {
+    if (!enabled) {
+        return;
+    }
+
+    Profiler &profiler = getProfiler();
+    std::lock_guard<std::mutex> lock(profiler.mutex);
+
+    boost::property_tree::ptree phases;
+    for (const std::string &name : profiler.phaseOrder) {
+        const PhaseTotal &total = profiler.phases[name];
+
+        boost::property_tree::ptree phase;
+        phase.put("seconds", total.seconds);
+        phase.put("calls", total.calls);
+        phase.put("rssGrowthKB", total.rssGrowthKB);
+        phase.put("peakRssGrowthKB", total.peakRssGrowthKB);
+        // names can have dots in them, which put would take as a path
+        phases.push_back(std::make_pair(name, phase));
+    }
+
+    boost::property_tree::ptree counts;
+    for (const std::pair<const std::string, long> &count : profiler.counts) {
+        counts.push_back(std::make_pair(count.first, boost::property_tree::ptree(std::to_string(count.second))));
+    }
+    counts.push_back(std::make_pair("unparseCalls", boost::property_tree::ptree(std::to_string(unparseCalls))));
+    counts.push_back(std::make_pair("querySubTreeCalls", boost::property_tree::ptree(std::to_string(queryCalls))));
+
+    boost::property_tree::ptree profile;
+    profile.add_child("phases", phases);
+    profile.add_child("counts", counts);
+    profile.put("peakRssKB", getPeakRssKB());
+
+    std::ofstream out(profiler.outputFile);
+    if (!out) {
+        std::cerr << "Couldn't write profile to " << profiler.outputFile << std::endl;
+        return;
+    }
+    boost::property_tree::write_json(out, profile);
+}
+
+Phase::Phase(const std::string &name) : enabled(::enabled) {
+    if (enabled) {
+        this->name = name;
+        beginRssKB = Balor::Limits::getRssKB();
+        beginPeakRssKB = getPeakRssKB();
+        begin = Clock::now();
+    }
+}
+
+Phase::~Phase() {
+    if (enabled) {
+        addPhase(name, begin, Clock::now(), beginRssKB, beginPeakRssKB);
+    }
+}
+
+} // namespace Profile
+} // namespace Balor
@@ -0,0 +1,59 @@
+#ifndef BALOR_PROFILE_H
+#define BALOR_PROFILE_H
+
+#include <chrono>
+#include <string>
+
+namespace Balor {
+namespace Profile {
+
+using Clock = std::chrono::steady_clock;
+
+// Record phases and counts from now on, and write them to the file as JSON when the program exits
+// nothing is recorded unless this is called, so the phases cost nothing otherwise
+void start(const std::string &outputFile);
+bool isEnabled();
+const std::string &getOutputFile();
+
+// Forget what has been recorded and record to another file, in a forked process, e.g. a --drive worker,
+// which has to write() itself as it exits without the exit handlers
+void restart(const std::string &outputFile);
+
+// Add a phase that ran before profiling could be started, e.g. ROSE_INITIALIZE before the command line is parsed
+// with the resident set and process peak when it began, 0 for a phase from the start of the process
+void addPhase(const std::string &name, Clock::time_point begin, Clock::time_point end, long beginRssKB = 0,
+              long beginPeakRssKB = 0);
+
+// Add to a named count, e.g. the nodes of a variant
+void count(const std::string &name, long amount = 1);
+
+// counted on every call, so kept without looking up a name
+void countUnparse();
+void countQuery();
+
+// Write what has been recorded:
+// {"phases": {name: {"seconds", "calls", "rssGrowthKB", "peakRssGrowthKB"}, ...}, "counts": {name: count, ...},
+//  "peakRssKB"}
+// phases are in the order they first ran, rssGrowthKB is the most the resident set grew over one call,
+// and peakRssGrowthKB how much the calls raised the process's peak, a nested phase's growth is in its parent's too
+void write();
+
+// Record the wall time of a phase while in scope,
+// phases with the same name add up, e.g. over the designs of a batch
+class Phase {
+  public:
+    Phase(const std::string &name);
+    ~Phase();
+
+  private:
+    std::string name;
+    Clock::time_point begin;
+    long beginRssKB = 0;
+    long beginPeakRssKB = 0;
+    bool enabled;
+};
+
+} // namespace Profile
+} // namespace Balor
+
+#endif
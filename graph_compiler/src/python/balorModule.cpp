@@ -0,0 +1,57 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../batch.h"
+#include "../serve.h"
+#include "rose.h"
+
+namespace py = pybind11;
+
+namespace {
+
+// parsed projects are kept for the life of the interpreter, like a server's
+Balor::Serve::CompilerSession &getSession() {
+    static Balor::Serve::CompilerSession session;
+    return session;
+}
+
+py::bytes compile(const std::string &src, const std::string &top, const std::vector<std::string> &flags,
+                  const std::map<std::string, std::string> &directives, const std::string &datasetIndex,
+                  const std::string &graphType) {
+    // always the binary format, so python can map the arrays without parsing text
+    std::vector<std::string> allFlags = flags;
+    allFlags.push_back("--format");
+    allFlags.push_back("bin");
+    allFlags.push_back("--add_bb_id");
+    allFlags.push_back("--add_cfg");
+
+    Balor::Batch::Design design;
+    design.datasetIndex = datasetIndex;
+    design.graphType = graphType;
+    design.directives = directives;
+
+    // the GIL is kept, ROSE and the session aren't safe to use from two threads at once
+    std::string graph = Balor::Serve::compileGraph(getSession(), allFlags, src, top, design);
+    return py::bytes(graph);
+}
+
+} // namespace
+
+PYBIND11_MODULE(balor_graph_compiler, module) {
+    module.doc() = "The Balor graph compiler, run inside the python process";
+
+    // Initialize and check compatibility. See Rose::initialize
+    ROSE_INITIALIZE;
+
+    // bad arguments come back as ValueError, like they would print from the command line
+    py::register_exception<std::invalid_argument>(module, "InvalidArgument", PyExc_ValueError);
+
+    module.def("compile", &compile, py::arg("src"), py::arg("top"), py::arg("flags") = std::vector<std::string>(),
+               py::arg("directives") = std::map<std::string, std::string>(), py::arg("dataset_index") = "",
+               py::arg("graph_type") = "",
+               "Generate the graph of the top function of src, in the binary format of --format bin");
+}
@@ -0,0 +1,471 @@
+#include "serve.h"
+#include "cache.h"
+#include "commandLine.h"
+#include "designLimits.h"
+#include "profile.h"
+#include "utility.h"
+#include "graph/args.h"
+#include "graph/graphGenerator.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+class StdioChannel : public Balor::Serve::Channel {
+  public:
+    bool readLine(std::string &line) override { return static_cast<bool>(std::getline(std::cin, line)); }
+    void write(const std::string &data) override { std::cout << data << std::flush; }
+};
+
+long getModifiedTime(const std::string &fileName) {
+    struct stat fileStat;
+    if (stat(fileName.c_str(), &fileStat) != 0) {
+        throw std::invalid_argument("Couldn't find source file: " + fileName);
+    }
+    return fileStat.st_mtime;
+}
+
+// Generate the graph of the top level function, with the directives applied if there are any
+std::string generateGraph(Balor::Serve::CompilerSession &session, Sawyer::CommandLine::ParserResult parserResult,
+                          SgProject *project, const Balor::Batch::Design &design, uint32_t *numNodes) {
+    std::string topLevelFunctionName = Balor::CommandLine::getTopLevelFunctionName(parserResult);
+    SgFunctionDefinition *topLevelFunctionDef;
+    {
+        Balor::Profile::Phase phase("getTopLevelFunctionDef");
+        topLevelFunctionDef = Balor::getTopLevelFunctionDef(project, topLevelFunctionName);
+    }
+
+    Balor::Batch::DirectiveApplier &directiveApplier = session.getDirectiveApplier(project);
+    bool applyDirectives = !design.directives.empty() || !design.vitisDirectives.empty();
+
+    SgGlobal *globalScope = SageInterface::getFirstGlobalScope(project);
+    SageBuilder::pushScopeStack(isSgScopeStatement(globalScope));
+
+    std::ostringstream graph;
+    std::streambuf *coutbuf = std::cout.rdbuf(); // save old buf
+
+    try {
+        if (applyDirectives) {
+            directiveApplier.apply(design);
+        }
+
+        Balor::Limits::Guard guard(Balor::CommandLine::getDesignTimeout(parserResult),
+                                   Balor::CommandLine::getDesignMaxRssKB(parserResult));
+
+        Balor::GraphGenerator graphGen(parserResult, &session.getArena());
+        graphGen.generateGraph(topLevelFunctionDef);
+
+        std::cout.rdbuf(graph.rdbuf()); // redirect std::cout
+        graphGen.printGraph();
+        std::cout.rdbuf(coutbuf); // restore cout
+
+        if (numNodes) {
+            *numNodes = graphGen.flatGraph.getNumNodes();
+        }
+    } catch (...) {
+        std::cout.rdbuf(coutbuf);
+        if (applyDirectives) {
+            directiveApplier.restore();
+        }
+        SageBuilder::popScopeStack();
+        throw;
+    }
+
+    // the next request on this project starts from the unmodified kernel
+    if (applyDirectives) {
+        directiveApplier.restore();
+    }
+    SageBuilder::popScopeStack();
+
+    return graph.str();
+}
+
+std::string writeHeader(boost::property_tree::ptree &header) {
+    std::ostringstream headerStream;
+    // not pretty printed, so the header is a single line
+    boost::property_tree::write_json(headerStream, header, false);
+    return headerStream.str();
+}
+
+} // namespace
+
+namespace Balor {
+namespace Serve {
+
+bool SocketChannel::readLine(std::string &line) {
+    size_t newline;
+    while ((newline = buffer.find('\n')) == std::string::npos) {
+        if (!fill()) {
+            // a last request without a newline still counts
+            if (buffer.empty()) {
+                return false;
+            }
+            line = buffer;
+            buffer.clear();
+            return true;
+        }
+    }
+
+    line = buffer.substr(0, newline);
+    buffer.erase(0, newline + 1);
+    return true;
+}
+
+bool SocketChannel::readBytes(size_t size, std::string &data) {
+    while (buffer.size() < size) {
+        if (!fill()) {
+            return false;
+        }
+    }
+
+    data = buffer.substr(0, size);
+    buffer.erase(0, size);
+    return true;
+}
+
+void SocketChannel::write(const std::string &data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        // don't let a client that hung up kill the server with SIGPIPE
+        ssize_t numWritten = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (numWritten < 0) {
+            throw std::runtime_error("Lost connection to client");
+        }
+        written += numWritten;
+    }
+}
+
+bool SocketChannel::fill() {
+    char chunk[4096];
+    ssize_t numRead = ::read(fd, chunk, sizeof(chunk));
+    if (numRead <= 0) {
+        return false;
+    }
+    buffer.append(chunk, numRead);
+    return true;
+}
+
+SgProject *CompilerSession::getProject(const std::vector<std::string> &frontendArgs) {
+    std::string key = boost::algorithm::join(frontendArgs, " ");
+
+    // the source file is the last frontend arg
+    long modifiedTime = getModifiedTime(frontendArgs.back());
+
+    auto cached = projects.find(key);
+    if (cached != projects.end() && cached->second.modifiedTime == modifiedTime) {
+        return cached->second.project;
+    }
+
+    // ROSE has no cheap way to free a project, so a stale one is left in memory
+    // anything the frontend prints would be read as a response when serving on stdout
+    std::streambuf *coutbuf = std::cout.rdbuf(std::cerr.rdbuf());
+    SgProject *project;
+    {
+        Balor::Profile::Phase phase("frontend");
+        project = frontend(frontendArgs);
+    }
+    std::cout.rdbuf(coutbuf);
+    if (!project) {
+        throw std::invalid_argument("Couldn't parse source file: " + frontendArgs.back());
+    }
+
+    CachedProject &entry = projects[key];
+    entry.project = project;
+    entry.modifiedTime = modifiedTime;
+    entry.directiveApplier.reset();
+
+    return project;
+}
+
+Cache::GraphCache *CompilerSession::getGraphCache(Sawyer::CommandLine::ParserResult parserResult) {
+    std::string directory = Balor::CommandLine::getCacheDir(parserResult);
+    if (directory.empty()) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Cache::GraphCache> &graphCache =
+        graphCaches[std::make_pair(directory, Balor::CommandLine::getCacheMaxBytes(parserResult))];
+    if (!graphCache) {
+        graphCache = Cache::makeGraphCache(parserResult);
+    }
+    return graphCache.get();
+}
+
+Batch::DirectiveApplier &CompilerSession::getDirectiveApplier(SgProject *project) {
+    for (auto &entry : projects) {
+        CachedProject &cached = entry.second;
+        if (cached.project != project) {
+            continue;
+        }
+
+        if (!cached.directiveApplier) {
+            cached.directiveApplier = std::make_unique<Batch::DirectiveApplier>(project);
+        }
+        return *cached.directiveApplier;
+    }
+    throw std::runtime_error("Project isn't in the session");
+}
+
+std::string compileGraph(CompilerSession &session, const std::vector<std::string> &flags, const std::string &src,
+                         const std::string &top, const Batch::Design &design, uint32_t *numNodes) {
+    // the request is turned into a command line, so it is checked the same way
+    std::vector<std::string> args = {"graph_compiler"};
+
+    for (std::string arg : flags) {
+        // flags can be given with or without the dashes
+        if (!boost::algorithm::starts_with(arg, "-")) {
+            arg = "--" + arg;
+        }
+        args.push_back(arg);
+    }
+
+    if (!src.empty()) {
+        args.push_back("--src");
+        args.push_back(src);
+    }
+    if (!top.empty()) {
+        args.push_back("--top");
+        args.push_back(top);
+    }
+    if (!design.datasetIndex.empty()) {
+        args.push_back("--datasetIndex");
+        args.push_back(design.datasetIndex);
+    }
+    if (!design.graphType.empty()) {
+        args.push_back("--graphType");
+        args.push_back(design.graphType);
+    }
+
+    std::vector<char *> argv;
+    for (std::string &arg : args) {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+
+    Sawyer::CommandLine::ParserResult parserResult = Balor::CommandLine::parseCommandLine(argv.size() - 1, argv.data());
+
+    std::vector<std::string> frontendArgs = Balor::CommandLine::getFrontendArgs(parserResult);
+
+    // the response has room for one graph
+    std::vector<std::string> formats = Balor::CommandLine::getOutputFormats(parserResult);
+    if (formats.size() > 1) {
+        throw std::invalid_argument("A request can only have one output format");
+    }
+    if (!Balor::CommandLine::getGraphConfigs(parserResult).empty()) {
+        throw std::invalid_argument("A request can only have one graph, give the switches of a config as flags");
+    }
+
+    // a graph made before from the same inputs doesn't need the project
+    Cache::GraphCache *graphCache = session.getGraphCache(parserResult);
+    std::string cacheInputs;
+    std::string extension = makeGraphWriter(formats.front())->getExtension();
+    if (graphCache) {
+        Batch::Design cacheDesign = design;
+        cacheDesign.datasetIndex = parserResult.parsed("datasetIndex").back().asString();
+        cacheDesign.graphType = parserResult.parsed("graphType").back().asString();
+        cacheInputs = Cache::describeInputs(Cache::describeSource(parserResult), parserResult, cacheDesign);
+
+        std::string graph;
+        if (graphCache->lookup(cacheInputs, extension, graph)) {
+            return graph;
+        }
+    }
+
+    SgProject *project = session.getProject(frontendArgs);
+    std::string graph;
+    try {
+        graph = generateGraph(session, parserResult, project, design, numNodes);
+    } catch (Limits::LimitExceeded &e) {
+        // the arena keeps the memory of the largest graph, which the next request doesn't need
+        if (e.reason == "memory") {
+            session.getArena().release();
+            Limits::releaseMemory();
+        }
+        throw;
+    }
+
+    if (graphCache) {
+        graphCache->store(cacheInputs, extension, graph);
+    }
+    return graph;
+}
+
+std::string handleRequest(CompilerSession &session, const std::string &request, const Defaults &defaults) {
+    boost::property_tree::ptree header;
+    std::string id;
+
+    try {
+        boost::property_tree::ptree tree;
+        try {
+            std::istringstream requestStream(request);
+            boost::property_tree::read_json(requestStream, tree);
+        } catch (boost::property_tree::json_parser_error e) {
+            throw std::invalid_argument("Couldn't parse request: " + e.message());
+        }
+
+        id = tree.get<std::string>("id", "");
+
+        std::vector<std::string> flags = defaults.flags;
+        if (auto requestFlags = tree.get_child_optional("flags")) {
+            for (auto &flag : *requestFlags) {
+                flags.push_back(flag.second.get_value<std::string>());
+            }
+        }
+
+        Batch::Design design;
+        design.datasetIndex = tree.get<std::string>("datasetIndex", defaults.datasetIndex);
+        design.graphType = tree.get<std::string>("graphType", defaults.graphType);
+
+        if (auto directives = tree.get_child_optional("directives")) {
+            for (auto &directive : *directives) {
+                design.directives[directive.first] = directive.second.get_value<std::string>();
+            }
+        }
+        if (auto vitisDirectives = tree.get_child_optional("vitisDirectives")) {
+            for (auto &directive : *vitisDirectives) {
+                design.vitisDirectives.push_back(directive.second.get_value<std::string>());
+            }
+        }
+
+        uint32_t numNodes = 0;
+        std::string graph = compileGraph(session, flags, tree.get<std::string>("src", ""),
+                                         tree.get<std::string>("top", ""), design, &numNodes);
+
+        if (!id.empty()) {
+            header.put("id", id);
+        }
+        header.put("status", "ok");
+        header.put("size", graph.size());
+        // a graph from the cache wasn't generated, so isn't counted
+        if (numNodes) {
+            header.put("nodes", numNodes);
+        }
+
+        return writeHeader(header) + graph;
+    } catch (std::exception &e) {
+        // a bad request shouldn't take down the server
+        header.clear();
+        if (!id.empty()) {
+            header.put("id", id);
+        }
+        header.put("status", "error");
+        header.put("message", e.what());
+        Limits::LimitExceeded *limitExceeded = dynamic_cast<Limits::LimitExceeded *>(&e);
+        if (limitExceeded) {
+            header.put("reason", limitExceeded->reason);
+        }
+
+        return writeHeader(header);
+    }
+}
+
+void serveChannel(CompilerSession &session, Channel &channel, const Defaults &defaults) {
+    std::string request;
+    while (channel.readLine(request)) {
+        boost::algorithm::trim(request);
+        if (request.empty()) {
+            continue;
+        }
+
+        // the parser and ROSE print to cout, which may be the channel, so only the graph writers get it
+        std::streambuf *coutbuf = std::cout.rdbuf(std::cerr.rdbuf());
+        std::string response;
+        try {
+            response = handleRequest(session, request, defaults);
+        } catch (...) {
+            std::cout.rdbuf(coutbuf);
+            throw;
+        }
+        std::cout.rdbuf(coutbuf);
+
+        channel.write(response);
+    }
+}
+
+Defaults makeDefaults(Sawyer::CommandLine::ParserResult parserResult) {
+    Defaults defaults;
+    for (auto arg : Balor::ARGS) {
+        if (parserResult.have(arg.first)) {
+            defaults.flags.push_back("--" + arg.first);
+        }
+    }
+    if (parserResult.have("max_nodes")) {
+        defaults.flags.push_back("--max_nodes=" + parserResult.parsed("max_nodes").back().asString());
+    }
+    // with a value, which is the last one given
+    for (const char *name : {"design_timeout", "design_max_rss", "cache_dir", "cache_max_mb", "format"}) {
+        if (parserResult.have(name)) {
+            defaults.flags.push_back(std::string("--") + name + "=" + parserResult.parsed(name).back().asString());
+        }
+    }
+    if (parserResult.have("datasetIndex")) {
+        defaults.datasetIndex = parserResult.parsed("datasetIndex").back().asString();
+    }
+    if (parserResult.have("graphType")) {
+        defaults.graphType = parserResult.parsed("graphType").back().asString();
+    }
+    return defaults;
+}
+
+int runServer(Sawyer::CommandLine::ParserResult parserResult) {
+    // requests use the switches the server was started with,
+    // so a worker can start a server with its usual invocation
+    Defaults defaults = makeDefaults(parserResult);
+    if (Balor::CommandLine::getOutputFormats(parserResult).size() > 1) {
+        throw std::invalid_argument("Only one output format can be served at a time");
+    }
+
+    CompilerSession session;
+
+    std::string socketPath = Balor::CommandLine::getServeSocket(parserResult);
+    if (socketPath.empty()) {
+        StdioChannel channel;
+        serveChannel(session, channel, defaults);
+        return 0;
+    }
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long: " << socketPath << std::endl;
+        return 1;
+    }
+    socketPath.copy(address.sun_path, socketPath.size());
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    // a previous server may have left the socket file behind
+    unlink(socketPath.c_str());
+    if (server < 0 || bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(server, 8) != 0) {
+        std::cerr << "Couldn't listen on socket: " << socketPath << std::endl;
+        return 1;
+    }
+
+    // one client at a time, the parsed projects are shared between them
+    while (true) {
+        int client = accept(server, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+
+        SocketChannel channel(client);
+        try {
+            serveChannel(session, channel, defaults);
+        } catch (std::runtime_error e) {
+            std::cerr << e.what() << std::endl;
+        }
+        close(client);
+    }
+}
+
+} // namespace Serve
+} // namespace Balor
@@ -0,0 +1,116 @@
+#ifndef BALOR_SERVE_H
+#define BALOR_SERVE_H
+
+#include <Rose/CommandLine.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "batch.h"
+#include "cache.h"
+#include "graph/graphArena.h"
+#include "rose.h"
+
+namespace Balor {
+namespace Serve {
+
+// Where requests come from and responses go to
+// either stdin/stdout or a connection on a unix domain socket
+class Channel {
+  public:
+    virtual ~Channel() = default;
+
+    // false when the other end has closed
+    virtual bool readLine(std::string &line) = 0;
+    virtual void write(const std::string &data) = 0;
+};
+
+// A connected unix domain socket, e.g. a client of --serve or a worker of --drive
+class SocketChannel : public Channel {
+  public:
+    SocketChannel(int fd) : fd(fd) {}
+
+    bool readLine(std::string &line) override;
+    // exactly size bytes, e.g. the graph after a response's header, false if the other end closed first
+    bool readBytes(size_t size, std::string &data);
+    void write(const std::string &data) override;
+
+    int getFD() const { return fd; }
+
+  private:
+    bool fill();
+
+    int fd;
+    std::string buffer;
+};
+
+// Keeps the parsed project of each source file between requests
+// a project is parsed again if its source file changed since
+class CompilerSession {
+  public:
+    SgProject *getProject(const std::vector<std::string> &frontendArgs);
+
+    // the directive applier of a cached project, made on first use
+    Batch::DirectiveApplier &getDirectiveApplier(SgProject *project);
+
+    // one graph is generated at a time, each reuses the memory of the last
+    GraphArena &getArena() { return arena; }
+
+    // the cache for a request's --cache_dir and --cache_max_mb, nullptr without one
+    // kept for the session, so it knows what it has stored and only evicts now and then
+    Cache::GraphCache *getGraphCache(Sawyer::CommandLine::ParserResult parserResult);
+
+  private:
+    struct CachedProject {
+        SgProject *project = nullptr;
+        long modifiedTime = 0;
+        std::unique_ptr<Batch::DirectiveApplier> directiveApplier;
+    };
+
+    // keyed by the full frontend invocation, so different include paths or defines don't collide
+    std::map<std::string, CachedProject> projects;
+
+    // by folder and size limit
+    std::map<std::pair<std::string, long>, std::unique_ptr<Cache::GraphCache>> graphCaches;
+
+    GraphArena arena;
+};
+
+// What the server was started with, used for anything a request doesn't specify
+struct Defaults {
+    // the graph switches, e.g. --inline_functions, added to every request
+    std::vector<std::string> flags;
+    std::string datasetIndex;
+    std::string graphType;
+};
+
+// The switches of the command line that requests use when they don't give their own
+Defaults makeDefaults(Sawyer::CommandLine::ParserResult parserResult);
+
+// Generate the graph of a kernel, as the command line with these switches would print it
+// the source file is only parsed if the session doesn't already have it
+// numNodes is set to the nodes of the graph when it was generated rather than found in the cache
+std::string compileGraph(CompilerSession &session, const std::vector<std::string> &flags, const std::string &src,
+                         const std::string &top, const Batch::Design &design, uint32_t *numNodes = nullptr);
+
+// Handle a single request, a JSON object of the form
+// {"id": ..., "src": "kernel.cpp", "top": "kernel", "flags": ["inline_functions", ...],
+//  "datasetIndex": ..., "graphType": ..., "directives": {"KEY": value, ...}, "vitisDirectives": [...]}
+// and return the response, a JSON header line followed by "size" bytes of dot graph,
+// the header has the graph's "nodes" when it was generated rather than found in the cache,
+// and an error has a "reason", timeout or memory, when the design went over --design_timeout or --design_max_rss
+std::string handleRequest(CompilerSession &session, const std::string &request, const Defaults &defaults);
+
+// Answer requests from the channel until it closes
+void serveChannel(CompilerSession &session, Channel &channel, const Defaults &defaults);
+
+// Serve requests until the input closes, or forever when listening on a socket
+int runServer(Sawyer::CommandLine::ParserResult parserResult);
+
+} // namespace Serve
+} // namespace Balor
+
+#endif
@@ -0,0 +1,106 @@
+#include "statusManifest.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/crc.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+uint32_t getCrc(const std::string &text) {
+    boost::crc_32_type crc;
+    crc.process_bytes(text.data(), text.size());
+    return crc.checksum();
+}
+
+std::string formatCrc(uint32_t crc) {
+    char hex[9];
+    snprintf(hex, sizeof(hex), "%08x", crc);
+    return hex;
+}
+
+} // namespace
+
+namespace Balor {
+namespace Batch {
+
+StatusManifest::StatusManifest(const std::string &fileName, bool resume) : fileName(fileName) {
+    long complete = resume ? read() : 0;
+
+    fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    // whatever an interrupted run left after its last complete entry would run into the next one
+    if (fd < 0 || ftruncate(fd, complete) != 0) {
+        throw std::invalid_argument("Couldn't open status manifest: " + fileName);
+    }
+}
+
+StatusManifest::~StatusManifest() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+long StatusManifest::read() {
+    std::ifstream manifest(fileName, std::ios::binary);
+    if (!manifest) {
+        return 0;
+    }
+
+    long complete = 0;
+    std::string line;
+    while (std::getline(manifest, line)) {
+        // the last line of an interrupted run may not have been finished
+        if (manifest.eof()) {
+            break;
+        }
+
+        std::vector<std::string> fields;
+        boost::algorithm::split(fields, line, boost::is_any_of("\t"));
+        if (fields.size() != 6 || fields[0] != formatCrc(getCrc(line.substr(fields[0].size() + 1)))) {
+            break;
+        }
+
+        Entry entry;
+        entry.name = fields[1];
+        entry.inputHash = fields[2];
+        entry.status = fields[3];
+        try {
+            entry.bytes = std::stoull(fields[4]);
+            entry.seconds = std::stod(fields[5]);
+        } catch (std::exception &e) {
+            break;
+        }
+        entries[entry.name] = entry;
+
+        complete += line.size() + 1;
+    }
+    return complete;
+}
+
+const StatusManifest::Entry *StatusManifest::find(const std::string &name) const {
+    auto entry = entries.find(name);
+    return entry == entries.end() ? nullptr : &entry->second;
+}
+
+void StatusManifest::add(const Entry &entry) {
+    std::ostringstream fields;
+    fields << entry.name << "\t" << entry.inputHash << "\t" << entry.status << "\t" << entry.bytes << "\t"
+           << entry.seconds;
+    std::string line = formatCrc(getCrc(fields.str())) + "\t" + fields.str() + "\n";
+
+    // appended in one write, so lines from a run that is stopped are whole or missing
+    if (::write(fd, line.data(), line.size()) != static_cast<ssize_t>(line.size())) {
+        throw std::runtime_error("Couldn't write to status manifest: " + fileName);
+    }
+    entries[entry.name] = entry;
+}
+
+} // namespace Batch
+} // namespace Balor
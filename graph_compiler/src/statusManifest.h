@@ -0,0 +1,52 @@
+#ifndef BALOR_STATUS_MANIFEST_H
+#define BALOR_STATUS_MANIFEST_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace Balor {
+namespace Batch {
+
+// What happened to each design of a batch, appended as each one finishes, so a run that was
+// stopped can carry on from where it got to without looking at the graphs it wrote
+//
+// one line per design: the crc32 of the rest of the line, then the name, the hash of its inputs,
+// the status, ok or the reason it failed, the bytes written and the seconds it took, tab separated
+// a line is written with a single write, after the design's graphs are in place, and a line that is
+// incomplete or doesn't match its crc32 is where an interrupted run stopped, so it and anything after are dropped
+class StatusManifest {
+  public:
+    struct Entry {
+        std::string name;
+        std::string inputHash;
+        std::string status;
+        uint64_t bytes = 0;
+        double seconds = 0;
+    };
+
+    // keeps the entries already in the file when resuming, starts an empty one otherwise
+    StatusManifest(const std::string &fileName, bool resume);
+    ~StatusManifest();
+
+    StatusManifest(const StatusManifest &) = delete;
+    StatusManifest &operator=(const StatusManifest &) = delete;
+
+    // the latest entry of the design, nullptr if it has none
+    const Entry *find(const std::string &name) const;
+
+    void add(const Entry &entry);
+
+  private:
+    std::string fileName;
+    int fd = -1;
+    std::map<std::string, Entry> entries;
+
+    // the entries of the file, returns the length of the part that is complete
+    long read();
+};
+
+} // namespace Batch
+} // namespace Balor
+
+#endif
@@ -0,0 +1,67 @@
+#include "useDefIndex.h"
+#include "utility.h"
+
+namespace Balor {
+
+UseDefIndex::UseDefIndex(SgFunctionDefinition *functionDef) {
+    // which argument of which call each argument expression is
+    std::unordered_map<SgExpression *, std::pair<SgFunctionCallExp *, size_t>> arguments;
+    for (SgNode *callNode : querySubTree(functionDef, V_SgFunctionCallExp)) {
+        SgFunctionCallExp *call = isSgFunctionCallExp(callNode);
+        SgExpressionPtrList &argExprs = call->get_args()->get_expressions();
+
+        // calls without variable arguments still have an entry per argument
+        argumentVariables[call].resize(argExprs.size());
+        for (size_t argIndex = 0; argIndex < argExprs.size(); argIndex++) {
+            arguments[argExprs[argIndex]] = std::make_pair(call, argIndex);
+        }
+    }
+
+    for (SgNode *varRefNode : querySubTree(functionDef, V_SgVarRefExp)) {
+        SgVarRefExp *varRef = isSgVarRefExp(varRefNode);
+        SgInitializedName *variable = varRef->get_symbol()->get_declaration();
+
+        uses[variable].push_back(varRef);
+
+        // a reference nested in call arguments, e.g. f(g(a[i])), is accessed by every call around it
+        for (SgNode *node = varRef; isSgExpression(node); node = node->get_parent()) {
+            auto argument = arguments.find(isSgExpression(node));
+            if (argument != arguments.end()) {
+                argumentVariables[argument->second.first][argument->second.second].insert(variable);
+            }
+        }
+    }
+}
+
+const std::vector<SgVarRefExp *> &UseDefIndex::getUses(SgInitializedName *variable) const {
+    static const std::vector<SgVarRefExp *> noUses;
+
+    auto found = uses.find(variable);
+    if (found == uses.end()) {
+        return noUses;
+    }
+    return found->second;
+}
+
+const std::vector<std::unordered_set<SgInitializedName *>> &
+UseDefIndex::getArgumentVariables(SgFunctionCallExp *call) const {
+    static const std::vector<std::unordered_set<SgInitializedName *>> noArguments;
+
+    auto found = argumentVariables.find(call);
+    if (found == argumentVariables.end()) {
+        return noArguments;
+    }
+    return found->second;
+}
+
+thread_local UseDefIndices *UseDefIndices::current = nullptr;
+
+const UseDefIndex &UseDefIndices::get(SgFunctionDefinition *functionDef) {
+    std::unique_ptr<UseDefIndex> &index = indices[functionDef];
+    if (!index) {
+        index = std::make_unique<UseDefIndex>(functionDef);
+    }
+    return *index;
+}
+
+} // namespace Balor
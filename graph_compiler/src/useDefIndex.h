@@ -0,0 +1,45 @@
+#ifndef BALOR_USE_DEF_INDEX_H
+#define BALOR_USE_DEF_INDEX_H
+
+#include "rose.h"
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Balor {
+
+// The variable uses of a function definition, found in a single walk of its body
+// so looking up the uses of a variable, or what a call passes, doesn't walk the body again
+class UseDefIndex {
+  public:
+    UseDefIndex(SgFunctionDefinition *functionDef);
+
+    // every reference to the variable in the function, in tree order
+    const std::vector<SgVarRefExp *> &getUses(SgInitializedName *variable) const;
+
+    // for each argument of a call in the function, the variables the argument expression accesses
+    // empty if the call isn't in the function
+    const std::vector<std::unordered_set<SgInitializedName *>> &getArgumentVariables(SgFunctionCallExp *call) const;
+
+  private:
+    std::unordered_map<SgInitializedName *, std::vector<SgVarRefExp *>> uses;
+    std::unordered_map<SgFunctionCallExp *, std::vector<std::unordered_set<SgInitializedName *>>> argumentVariables;
+};
+
+// The indices of the function definitions one graph looks at, each built the first time it is asked for
+// a graph generator owns them, so they go with its build and threads building other graphs never share them
+class UseDefIndices {
+  public:
+    const UseDefIndex &get(SgFunctionDefinition *functionDef);
+
+    // the indices of the graph being built on this thread, null outside a build
+    static thread_local UseDefIndices *current;
+
+  private:
+    std::unordered_map<SgFunctionDefinition *, std::unique_ptr<UseDefIndex>> indices;
+};
+
+} // namespace Balor
+#endif
@@ -1,6 +1,11 @@
 #include "utility.h"
 #include "rose.h"
 #include "unordered_set"
+#include "designLimits.h"
+#include "profile.h"
+#include "useDefIndex.h"
+
+#include <algorithm>
 
 #include <boost/algorithm/string.hpp>
 
@@ -10,9 +15,24 @@ namespace Balor {
 // Expressions can nest endlessly,
 // so check if an expression accesses a variable at any point in its tree
 bool expressionAccessesVariable(SgExpression *expression, SgInitializedName *variable) {
+    // call arguments are already in the index of the function they're in
+    SgExprListExp *argList = isSgExprListExp(expression->get_parent());
+    SgFunctionCallExp *functionCall = argList ? isSgFunctionCallExp(argList->get_parent()) : nullptr;
+    SgFunctionDefinition *functionDef = SageInterface::getEnclosingFunctionDefinition(expression);
+    if (functionCall && functionCall->get_args() == argList && functionDef && UseDefIndices::current) {
+        SgExpressionPtrList &argExprs = argList->get_expressions();
+        size_t argIndex = std::find(argExprs.begin(), argExprs.end(), expression) - argExprs.begin();
+
+        // a call the index doesn't have, e.g. one added to the AST after it was built, is walked below
+        const std::vector<std::unordered_set<SgInitializedName *>> &argumentVariables =
+            UseDefIndices::current->get(functionDef).getArgumentVariables(functionCall);
+        if (argIndex < argumentVariables.size()) {
+            return argumentVariables[argIndex].count(variable) > 0;
+        }
+    }
 
     // get all of the variables references in the expression
-    std::vector<SgNode *> variableRefs = NodeQuery::querySubTree(expression, V_SgVarRefExp);
+    std::vector<SgNode *> variableRefs = querySubTree(expression, V_SgVarRefExp);
 
     // foreach variable reference
     for (SgNode *variableRefNode : variableRefs) {
@@ -71,7 +91,7 @@ SgInitializedName *findParameterInScope(SgFunctionCallExp *functionCall, SgIniti
 // specified by the CLI argument
 SgFunctionDefinition *getTopLevelFunctionDef(SgProject *project, std::string topLevelFunctionName) {
     // get all function definitions in the project
-    std::vector<SgNode *> functionCallList = NodeQuery::querySubTree(project, V_SgFunctionDefinition);
+    std::vector<SgNode *> functionCallList = querySubTree(project, V_SgFunctionDefinition);
 
     // declare the pointer to return
     // Initialise to null to check if the definition was actually found
@@ -105,26 +125,11 @@ std::vector<SgVarRefExp *> findVariableReferences(SgFunctionCallExp *functionCal
     // get the function declaration
     SgFunctionDeclaration *functionDec = getFuncDecFromCall(functionCall);
 
-    // get all variable uses in the function
-    std::vector<SgNode *> variableRefs = NodeQuery::querySubTree(functionDec->get_definition(), V_SgVarRefExp);
-
-    std::vector<SgVarRefExp *> parameterUses;
-
-    for (SgNode *varRefNode : variableRefs) {
-        // get the variable refernce
-        SgVarRefExp *varRef = isSgVarRefExp(varRefNode);
-
-        // get the variable declaration
-        SgInitializedName *usedVariable = varRef->get_symbol()->get_declaration();
-
-        // if this reference is to the chosen parameter
-        // add it to the vector
-        if (parameter == usedVariable) {
-            parameterUses.push_back(varRef);
-        }
+    // every use of every variable in the function is indexed the first time the graph looks at it
+    if (UseDefIndices::current) {
+        return UseDefIndices::current->get(functionDec->get_definition()).getUses(parameter);
     }
-
-    return parameterUses;
+    return UseDefIndex(functionDec->get_definition()).getUses(parameter);
 }
 
 // Helper function which gets the defining function declaration
@@ -165,4 +170,16 @@ SgFunctionDeclaration *getFuncDecFromCall(SgFunctionCallExp *functionCall) {
     }
 }
 
-} // namespace Balor
\ No newline at end of file
+std::string unparse(SgNode *node) {
+    Profile::countUnparse();
+    Limits::check();
+    return node->unparseToString();
+}
+
+std::vector<SgNode *> querySubTree(SgNode *node, VariantT variant, AstQueryNamespace::QueryDepth depth) {
+    Profile::countQuery();
+    Limits::check();
+    return NodeQuery::querySubTree(node, variant, depth);
+}
+
+} // namespace Balor
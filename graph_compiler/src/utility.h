@@ -14,6 +14,11 @@ bool expressionAccessesVariable(SgExpression *expression, SgInitializedName *var
 std::vector<SgVarRefExp *> findVariableReferences(SgFunctionCallExp *functionCall, SgInitializedName *parameter);
 SgInitializedName *findParameterInScope(SgFunctionCallExp *functionCall, SgInitializedName *parameter);
 
+// unparseToString and NodeQuery::querySubTree, counted when profiling
+std::string unparse(SgNode *node);
+std::vector<SgNode *> querySubTree(SgNode *node, VariantT variant,
+                                   AstQueryNamespace::QueryDepth depth = AstQueryNamespace::AllNodes);
+
 
 } // namespace Balor
 #endif
\ No newline at end of file